@@ -0,0 +1,177 @@
+/*
+ * implementation for the daemon's control socket
+ *
+ * the reply is kept in memory until every line of the request has been
+ * handled, so nothing is sent while a command runs (the daemon runs them
+ * with its signals blocked); the buffer grows as needed, and is only sent
+ * early if it cannot
+ */
+
+#define _GNU_SOURCE
+#include "control.h"
+#include "p1fxns.h"
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/time.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#define CTL_BUFSIZE 65536
+
+static int listen_fd = -1;
+static char *sock_path = NULL;
+
+/* the reply is gathered in this buffer */
+static char *out;
+static long outlen, outcap;
+static int client = -1;
+
+int ctl_open(char *path) {
+    struct sockaddr_un addr;
+
+    if (p1strlen(path) >= (int)sizeof(addr.sun_path)) {
+        p1putstr(2, "control socket path is too long\n");
+        return 0;
+    }
+    listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd == -1) {
+        p1perror(2, "error creating control socket");
+        return 0;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    p1strcpy(addr.sun_path, path);
+    unlink(path);
+    if (bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) == -1
+        || listen(listen_fd, 64) == -1) {
+        p1perror(2, "error binding control socket");
+        close(listen_fd);
+        listen_fd = -1;
+        return 0;
+    }
+    fcntl(listen_fd, F_SETFL, O_NONBLOCK);
+    sock_path = path;
+    return 1;
+}
+
+int ctl_fd(void) {
+    return listen_fd;
+}
+
+static void out_flush(void) {
+    char *p = out;
+
+    while (outlen > 0 && client != -1) {
+        long w = send(client, p, outlen, MSG_NOSIGNAL);
+
+        if (w < 0 && errno == EINTR)
+            continue;
+        if (w <= 0)
+            break;		/* client went away; drop the rest */
+        p += w;
+        outlen -= w;
+    }
+    outlen = 0;
+}
+
+void ctl_reply(char *s) {
+    while (*s != '\0') {
+        if (outlen == outcap) {
+            long cap = (outcap == 0) ? CTL_BUFSIZE : 2 * outcap;
+            char *tmp = (char *)realloc(out, cap);
+
+            if (tmp != NULL) {
+                out = tmp;
+                outcap = cap;
+            } else if (outcap > 0)
+                out_flush();	/* out of memory: send what there is */
+            else
+                return;
+        }
+        out[outlen++] = *s++;
+    }
+}
+
+void ctl_replylong(long n) {
+    char buf[25];
+
+    p1ltoa(n, buf);
+    ctl_reply(buf);
+}
+
+/*
+ * reads until the client shuts down its side; returns a malloc()ed,
+ * EOS-terminated buffer, or NULL
+ */
+static char *read_request(void) {
+    long size = CTL_BUFSIZE, len = 0;
+    char *buf = (char *)malloc(size + 1);
+
+    while (buf != NULL) {
+        long n;
+
+        if (len == size) {
+            char *tmp = (char *)realloc(buf, 2 * size + 1);
+
+            if (tmp == NULL) {
+                free(buf);
+                return NULL;
+            }
+            buf = tmp;
+            size *= 2;
+        }
+        n = read(client, buf + len, size - len);
+        if (n < 0 && errno == EINTR)
+            continue;		/* a time slice ended */
+        if (n <= 0)
+            break;
+        len += n;
+    }
+    if (buf != NULL)
+        buf[len] = '\0';
+    return buf;
+}
+
+void ctl_serve(void (*command)(char *line)) {
+    struct timeval tv = {1, 0};	/* a silent client can't stall the loop */
+    char *req, *line;
+
+    if (listen_fd == -1 || (client = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC)) == -1)
+        return;
+    setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    outlen = 0;
+    if ((req = read_request()) == NULL) {
+        ctl_reply("error out of memory\n");
+    } else {
+        for (line = req; *line != '\0'; ) {
+            int n = p1strchr(line, '\n');
+            char *next = (n == -1) ? line + p1strlen(line) : line + n + 1;
+
+            if (n != -1)
+                line[n] = '\0';
+            if (line[0] != '\0')
+                (*command)(line);
+            line = next;
+        }
+        free(req);
+    }
+    out_flush();
+    close(client);
+    client = -1;
+}
+
+void ctl_close(void) {
+    if (listen_fd == -1)
+        return;
+    close(listen_fd);
+    unlink(sock_path);
+    listen_fd = -1;
+    free(out);
+    out = NULL;
+    outlen = outcap = 0;
+}
@@ -0,0 +1,51 @@
+#ifndef _CONTROL_H_
+#define _CONTROL_H_
+
+/*
+ * interface definition for the daemon's control socket
+ *
+ * a client connects to the Unix domain socket, writes one command per line,
+ * and shuts down its writing side; the daemon answers with one reply line
+ * per command and closes the connection, so any number of commands (e.g.
+ * thousands of submissions) travel in a single request
+ *
+ * this module only moves bytes; the commands are interpreted by the caller
+ * of ctl_serve()
+ */
+
+/*
+ * creates the listening socket `path', replacing a stale socket file
+ *
+ * returns 1 if successful, 0 if not
+ */
+int ctl_open(char *path);
+
+/*
+ * returns the listening socket, or -1 if there is none
+ */
+int ctl_fd(void);
+
+/*
+ * accepts one pending connection, reads the whole request and calls
+ * `command' on each non-blank line of it (without the newline); the replies
+ * written by `command' through ctl_reply() are kept in memory and sent
+ * back when all lines have been handled, after `command' has returned
+ */
+void ctl_serve(void (*command)(char *line));
+
+/*
+ * appends `s' to the reply of the request being served
+ */
+void ctl_reply(char *s);
+
+/*
+ * appends the decimal form of `n' to the reply of the request being served
+ */
+void ctl_replylong(long n);
+
+/*
+ * closes the listening socket and removes the socket file
+ */
+void ctl_close(void);
+
+#endif /* _CONTROL_H_ */
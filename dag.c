@@ -0,0 +1,233 @@
+/*
+ * implementation for job dependency graphs
+ *
+ * names are found through an open-addressing hash table; the dependents of
+ * all jobs are stored in one array, those of job j at first[j] .. first[j+1]-1
+ */
+
+#include "dag.h"
+#include "p1fxns.h"
+#include <stdlib.h>
+
+struct dag {
+    long n;
+    char **names;	/* borrowed until dag_build() */
+    char **afters;	/* borrowed until dag_build() */
+    long *indegree;
+    long *rank;
+    long *first;	/* n + 1 entries */
+    long *dependents;
+};
+
+Dag *dag_create(long n) {
+    Dag *dag = (Dag *)malloc(sizeof(Dag));
+
+    if (dag != NULL) {
+        dag->n = n;
+        dag->names = (char **)calloc(n + 1, sizeof(char *));
+        dag->afters = (char **)calloc(n + 1, sizeof(char *));
+        dag->indegree = (long *)calloc(n + 1, sizeof(long));
+        dag->rank = (long *)calloc(n + 1, sizeof(long));
+        dag->first = (long *)calloc(n + 1, sizeof(long));
+        dag->dependents = NULL;
+        if (dag->names == NULL || dag->afters == NULL || dag->indegree == NULL
+            || dag->rank == NULL || dag->first == NULL) {
+            dag_destroy(dag);
+            return NULL;
+        }
+    }
+    return dag;
+}
+
+void dag_destroy(Dag *dag) {
+    free(dag->names);
+    free(dag->afters);
+    free(dag->indegree);
+    free(dag->rank);
+    free(dag->first);
+    free(dag->dependents);
+    free(dag);
+}
+
+void dag_set(Dag *dag, long job, char *name, char *after) {
+    dag->names[job] = name;
+    dag->afters[job] = after;
+}
+
+static unsigned long hash(char *s, int len) {
+    unsigned long h = 14695981039346656037UL;	/* FNV-1a */
+    int i;
+
+    for (i = 0; i < len; i++)
+        h = (h ^ (unsigned char)s[i]) * 1099511628211UL;
+    return h;
+}
+
+/*
+ * returns the job named by the `len' characters at `s' in the table of
+ * `size' slots, or -1
+ */
+static long lookup(Dag *dag, long *table, long size, char *s, int len) {
+    unsigned long i = hash(s, len) & (size - 1);
+
+    for (; table[i] != -1; i = (i + 1) & (size - 1)) {
+        char *name = dag->names[table[i]];
+
+        if (p1strneq(name, s, len) && name[len] == '\0')
+            return table[i];
+    }
+    return -1L;
+}
+
+/*
+ * calls back for each dependency of `job', with the job it names (or -1)
+ */
+static int each_after(Dag *dag, long *table, long size, long job,
+                      int (*fn)(Dag *, long, long, char *, int)) {
+    char *s = dag->afters[job];
+
+    while (s != NULL && *s != '\0') {
+        int len = p1strchr(s, ',');
+
+        if (len == -1)
+            len = p1strlen(s);
+        if (len > 0 && !(*fn)(dag, job, lookup(dag, table, size, s, len), s, len))
+            return 0;
+        s += len + (s[len] == ',');
+    }
+    return 1;
+}
+
+static void unknown(char *s, int len) {
+    char name[len + 1];
+    int i;
+
+    for (i = 0; i < len; i++)
+        name[i] = s[i];
+    name[len] = '\0';
+    p1putstr(2, "workload: after= names an unknown job: ");
+    p1putstr(2, name);
+    p1putstr(2, "\n");
+}
+
+static int count_edge(Dag *dag, long job, long dep, char *s, int len) {
+    if (dep == -1) {
+        unknown(s, len);
+        return 0;
+    }
+    dag->first[dep + 1]++;
+    dag->indegree[job]++;
+    return 1;
+}
+
+static int add_edge(Dag *dag, long job, long dep, char *s, int len) {
+    (void)s;
+    (void)len;
+    dag->dependents[dag->first[dep]++] = job;	/* first[] is put back afterwards */
+    return 1;
+}
+
+int dag_build(Dag *dag) {
+    long size = 2, *table, *order, *left, i, j, head = 0, tail = 0;
+    int ok = 0;
+
+    while (size < 2 * dag->n)
+        size *= 2;
+    table = (long *)malloc(size * sizeof(long));
+    order = (long *)malloc((dag->n + 1) * sizeof(long));
+    left = (long *)malloc((dag->n + 1) * sizeof(long));
+    if (table == NULL || order == NULL || left == NULL) {
+        p1putstr(2, "workload: out of memory for dependencies\n");
+        goto out;
+    }
+    for (i = 0; i < size; i++)
+        table[i] = -1L;
+    for (i = 0; i < dag->n; i++) {
+        char *name = dag->names[i];
+        unsigned long h;
+
+        if (name == NULL)
+            continue;
+        if (lookup(dag, table, size, name, p1strlen(name)) != -1) {
+            p1putstr(2, "workload: job name given twice: ");
+            p1putstr(2, name);
+            p1putstr(2, "\n");
+            goto out;
+        }
+        for (h = hash(name, p1strlen(name)) & (size - 1); table[h] != -1; h = (h + 1) & (size - 1))
+            ;
+        table[h] = i;
+    }
+
+    /* count the dependents of each job, then lay them out */
+    for (i = 0; i < dag->n; i++)
+        if (!each_after(dag, table, size, i, &count_edge))
+            goto out;
+    for (i = 0; i < dag->n; i++)
+        dag->first[i + 1] += dag->first[i];
+    if ((dag->dependents = (long *)malloc((dag->first[dag->n] + 1) * sizeof(long))) == NULL) {
+        p1putstr(2, "workload: out of memory for dependencies\n");
+        goto out;
+    }
+    for (i = 0; i < dag->n; i++)
+        each_after(dag, table, size, i, &add_edge);
+    for (i = dag->n; i > 0; i--)
+        dag->first[i] = dag->first[i - 1];
+    dag->first[0] = 0;
+
+    /* order the jobs (Kahn), then rank them from the last one back */
+    for (i = 0; i < dag->n; i++)
+        if ((left[i] = dag->indegree[i]) == 0)
+            order[tail++] = i;
+    while (head < tail) {
+        long job = order[head++];
+
+        for (j = dag->first[job]; j < dag->first[job + 1]; j++)
+            if (--left[dag->dependents[j]] == 0)
+                order[tail++] = dag->dependents[j];
+    }
+    if (tail < dag->n) {
+        p1putstr(2, "workload: dependency cycle among jobs:");
+        for (i = 0; i < dag->n; i++) {
+            if (left[i] == 0)
+                continue;
+            p1putstr(2, " ");
+            if (dag->names[i] != NULL)
+                p1putstr(2, dag->names[i]);
+            else
+                p1putint(2, (int)i);
+        }
+        p1putstr(2, "\n");
+        goto out;
+    }
+    for (i = dag->n - 1; i >= 0; i--) {
+        long job = order[i];
+
+        for (j = dag->first[job]; j < dag->first[job + 1]; j++)
+            if (dag->rank[dag->dependents[j]] + 1 > dag->rank[job])
+                dag->rank[job] = dag->rank[dag->dependents[j]] + 1;
+    }
+    ok = 1;
+out:
+    free(table);
+    free(order);
+    free(left);
+    for (i = 0; i < dag->n; i++)
+        dag->names[i] = dag->afters[i] = NULL;
+    return ok;
+}
+
+long dag_indegree(Dag *dag, long job) {
+    return (job < dag->n) ? dag->indegree[job] : 0L;
+}
+
+long dag_rank(Dag *dag, long job) {
+    return (job < dag->n) ? dag->rank[job] : 0L;
+}
+
+long dag_dependents(Dag *dag, long job, long **list) {
+    if (job >= dag->n || dag->dependents == NULL)
+        return 0L;
+    *list = dag->dependents + dag->first[job];
+    return dag->first[job + 1] - dag->first[job];
+}
@@ -0,0 +1,63 @@
+#ifndef _DAG_H_
+#define _DAG_H_
+
+/*
+ * interface definition for job dependency graphs
+ *
+ * jobs 0 .. n-1 may be given names, and lists of the names of the jobs they
+ * run after; dag_build() resolves the names, checks that the dependencies
+ * form a DAG, and lays out each job's dependents in one array, so that a
+ * job's completion is handled in O(out-degree)
+ *
+ * a job's rank is the number of jobs on the longest chain of dependents
+ * below it: jobs on the critical path have the highest rank, and jobs that
+ * nothing depends on have rank 0
+ */
+
+typedef struct dag Dag;		/* opaque type definition */
+
+/*
+ * creates a graph of `n' jobs without names or dependencies
+ *
+ * returns a pointer to the graph, or NULL if there are malloc() errors
+ */
+Dag *dag_create(long n);
+
+/*
+ * destroys the graph
+ */
+void dag_destroy(Dag *dag);
+
+/*
+ * names job `job' `name' and has it run after the jobs named in the
+ * comma-separated list `after' (either may be NULL); the strings are
+ * borrowed until dag_build() returns
+ */
+void dag_set(Dag *dag, long job, char *name, char *after);
+
+/*
+ * resolves the names and orders the jobs
+ *
+ * returns 1 if successful, 0 if a name is unknown or given twice, the
+ * dependencies form a cycle, or there are malloc() errors (the reason, and
+ * the jobs involved, have been written to standard error)
+ */
+int dag_build(Dag *dag);
+
+/*
+ * returns the number of jobs `job' runs after
+ */
+long dag_indegree(Dag *dag, long job);
+
+/*
+ * returns the rank of `job'
+ */
+long dag_rank(Dag *dag, long job);
+
+/*
+ * returns the number of jobs that run after `job', and in `*list' where
+ * their indexes are; jobs beyond the graph have none
+ */
+long dag_dependents(Dag *dag, long job, long **list);
+
+#endif /* _DAG_H_ */
@@ -0,0 +1,109 @@
+/*
+ * implementation for hot-path instrumentation
+ *
+ * a histogram bucket holds the durations with the same highest set bit and
+ * the same two bits below it, so it is found with one count-leading-zeros
+ * and its width is at most a quarter of its lower bound
+ */
+
+#include "hotpath.h"
+#include "p1fxns.h"
+#include <time.h>
+
+typedef struct phase {
+    uint64_t calls;
+    uint64_t total_ns;
+    uint64_t max_ns;
+    uint64_t syscalls;
+    uint64_t buckets[HP_BUCKETS];
+} phase_t;
+
+static phase_t phases[HP_PHASES];
+static uint64_t syscalls;
+static char *names[HP_PHASES] = {"timer_wake", "pick_next", "stop_signal",
+                                 "continue_signal", "queue_ops", "reap"};
+
+hp_mark_t hp_begin(void) {
+    struct timespec ts;
+    hp_mark_t mark;
+
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    mark.ns = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    mark.syscalls = syscalls;
+    return mark;
+}
+
+static int bucket(uint64_t ns) {
+    int msb;
+
+    if (ns < 4)
+        return (int)ns;
+    msb = 63 - __builtin_clzll(ns);
+    return 4 * (msb - 1) + (int)((ns >> (msb - 2)) & 3);
+}
+
+static uint64_t upper_bound(int b) {
+    int msb = b / 4 + 1;
+
+    if (b < 4)
+        return (uint64_t)b;
+    return ((uint64_t)(4 + b % 4) << (msb - 2)) + (1ULL << (msb - 2)) - 1;
+}
+
+void hp_end(int phase, hp_mark_t mark) {
+    phase_t *p = &phases[phase];
+    uint64_t ns = hp_begin().ns - mark.ns;
+
+    p->calls++;
+    p->total_ns += ns;
+    if (ns > p->max_ns)
+        p->max_ns = ns;
+    p->syscalls += syscalls - mark.syscalls;
+    p->buckets[bucket(ns)]++;
+}
+
+void hp_syscalls(int n) {
+    syscalls += n;
+}
+
+static uint64_t percentile(phase_t *p, int pct) {
+    uint64_t want = (p->calls * pct + 99) / 100, seen = 0;
+    int b;
+
+    for (b = 0; b < HP_BUCKETS; b++)
+        if ((seen += p->buckets[b]) >= want)
+            break;
+    return (b < HP_BUCKETS && upper_bound(b) < p->max_ns) ? upper_bound(b) : p->max_ns;
+}
+
+static void put(int fd, char *label, uint64_t value) {
+    char buf[25];
+
+    p1putstr(fd, " ");
+    p1putstr(fd, label);
+    p1putstr(fd, " ");
+    p1ltoa((long)value, buf);
+    p1putstr(fd, buf);
+}
+
+void hp_report(int fd) {
+    int i;
+
+    for (i = 0; i < HP_PHASES; i++) {
+        phase_t *p = &phases[i];
+
+        if (p->calls == 0)
+            continue;
+        p1putstr(fd, "hotpath ");
+        p1putstr(fd, names[i]);
+        put(fd, "calls", p->calls);
+        put(fd, "total_us", p->total_ns / 1000);
+        put(fd, "mean_ns", p->total_ns / p->calls);
+        put(fd, "p50_ns", percentile(p, 50));
+        put(fd, "p90_ns", percentile(p, 90));
+        put(fd, "p99_ns", percentile(p, 99));
+        put(fd, "max_ns", p->max_ns);
+        put(fd, "syscalls", p->syscalls);
+        p1putstr(fd, "\n");
+    }
+}
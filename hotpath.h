@@ -0,0 +1,71 @@
+#ifndef _HOTPATH_H_
+#define _HOTPATH_H_
+
+/*
+ * interface definition for hot-path instrumentation
+ *
+ * the scheduler's own dispatch path is split into phases; each time a
+ * phase runs, its duration (CLOCK_MONOTONIC_RAW, read through the vDSO)
+ * goes into a log-bucket histogram, and the system calls it made are
+ * counted; hp_report() prints them at exit
+ *
+ * all of it is compiled in only with -DUSPS_HOTPATH (make HOTPATH=1):
+ * otherwise the HP_ macros expand to nothing and cost nothing
+ *
+ * updates are made from the signal handlers and from the main loop with
+ * the scheduler's signals blocked, so there is one writer at a time
+ */
+
+#include <stdint.h>
+
+/* phases */
+#define HP_TIMER 0	/* the SIGALRM handler, the phases it runs included */
+#define HP_PICK 1	/* filling idle slots from the ready queues */
+#define HP_STOP 2	/* stopping a job */
+#define HP_CONT 3	/* continuing a job, or starting it */
+#define HP_QUEUE 4	/* putting a job on a ready queue, or taking it off */
+#define HP_REAP 5	/* the SIGCHLD handler, the phases it runs included */
+#define HP_PHASES 6
+
+#define HP_BUCKETS 256	/* 4 per power of two of nsec */
+
+typedef struct hp_mark {
+    uint64_t ns;
+    uint64_t syscalls;
+} hp_mark_t;
+
+/*
+ * returns the time and the number of system calls so far, for hp_end()
+ */
+hp_mark_t hp_begin(void);
+
+/*
+ * accounts for a run of `phase' begun at `mark'
+ */
+void hp_end(int phase, hp_mark_t mark);
+
+/*
+ * counts `n' system calls made by the phases running
+ */
+void hp_syscalls(int n);
+
+/*
+ * writes, for each phase that ran, "hotpath <phase> calls <n> total_us <u>
+ * mean_ns <m> p50_ns <p> p90_ns <p> p99_ns <p> max_ns <m> syscalls <s>"
+ * on `fd'; percentiles are the upper bounds of their buckets
+ */
+void hp_report(int fd);
+
+#ifdef USPS_HOTPATH
+#define HP_BEGIN(mark) hp_mark_t mark = hp_begin()
+#define HP_END(phase, mark) hp_end((phase), (mark))
+#define HP_SYSCALLS(n) hp_syscalls(n)
+#define HP_REPORT(fd) hp_report(fd)
+#else
+#define HP_BEGIN(mark)
+#define HP_END(phase, mark)
+#define HP_SYSCALLS(n)
+#define HP_REPORT(fd)
+#endif
+
+#endif /* _HOTPATH_H_ */
@@ -1,74 +0,0 @@
-/*
- * Copyright (c) 2013, Court of the University of Glasgow
- * All rights reserved.
-
- * Redistribution and use in source and binary forms, with or without
- * modification, are permitted provided that the following conditions are met:
-
- * - Redistributions of source code must retain the above copyright notice,
- *   this list of conditions and the following disclaimer.
- *
- * - Redistributions in binary form must reproduce the above copyright notice,
- *   this list of conditions and the following disclaimer in the documentation
- *   and/or other materials provided with the distribution.
- *
- * - Neither the name of the University of Glasgow nor the names of its
- *   contributors may be used to endorse or promote products derived from this
- *   software without specific prior written permission.
- *
- * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
- * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
- * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
- * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
- * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
- * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
- * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
- * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
- * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
- * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
- * POSSIBILITY OF SUCH DAMAGE.
- */
-
-#include "iterator.h"
-#include <stdlib.h>
-
-/*
- * implementation for generic iterator
- *
- * patterned roughly after Java 6 Iterator class
- */
-
-struct iterator {
-    long next;
-    long size;
-    void **elements;
-};
-
-Iterator *it_create(long size, void **elements) {
-    Iterator *it = (Iterator *)malloc(sizeof(Iterator));
-
-    if (it != NULL) {
-        it->next = 0L;
-        it->size = size;
-        it->elements = elements;
-    }
-    return it;
-}
-
-int it_hasNext(Iterator *it) {
-    return (it->next < it->size) ? 1 : 0;
-}
-
-int it_next(Iterator *it, void **element) {
-    int status = 0;
-    if (it->next < it->size) {
-        *element = it->elements[it->next++];
-        status = 1;
-    }
-    return status;
-}
-
-void it_destroy(Iterator *it) {
-    free(it->elements);
-    free(it);
-}
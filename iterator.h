@@ -1,71 +0,0 @@
-#ifndef _ITERATOR_H_
-#define _ITERATOR_H_
-
-/*
- * Copyright (c) 2013, Court of the University of Glasgow
- * All rights reserved.
-
- * Redistribution and use in source and binary forms, with or without
- * modification, are permitted provided that the following conditions are met:
-
- * - Redistributions of source code must retain the above copyright notice,
- *   this list of conditions and the following disclaimer.
- *
- * - Redistributions in binary form must reproduce the above copyright notice,
- *   this list of conditions and the following disclaimer in the documentation
- *   and/or other materials provided with the distribution.
- *
- * - Neither the name of the University of Glasgow nor the names of its
- *   contributors may be used to endorse or promote products derived from this
- *   software without specific prior written permission.
- *
- * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
- * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
- * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
- * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
- * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
- * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
- * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
- * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
- * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
- * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
- * POSSIBILITY OF SUCH DAMAGE.
- */
-
-/*
- * interface definition for generic iterator
- *
- * patterned roughly after Java 6 Iterator class
- */
-
-typedef struct iterator Iterator;
-
-/*
- * creates an iterator from the supplied arguments; it is for use by the
- * iterator factory methods in ADTs
- *
- * NB - iterator assumes responsibility for elements[] if create is successful
- * i.e. it_destroy will free the array of pointers
- *
- * returns pointer to iterator if successful, NULL otherwise
- */
-Iterator *it_create(long size, void **elements);
-
-/*
- * returns 1/0 if the iterator has a next element
- */
-int it_hasNext(Iterator *it);
-
-/*
- * returns the next element from the iterator in `*element'
- *
- * returns 1 if successful, 0 if unsuccessful (no next element)
- */
-int it_next(Iterator *it, void **element);
-
-/*
- * destroys the iterator
- */
-void it_destroy(Iterator *it);
-
-#endif /* _ITERATOR_H_ */
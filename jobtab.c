@@ -0,0 +1,151 @@
+/*
+ * implementation for the job table and reaper
+ *
+ * with JT_ALL, each child is first looked at with waitid(WNOWAIT), which
+ * leaves it waitable, so that a child that is not a job can still be
+ * matched by its process group before wait4() collects it (and its CPU
+ * time); without, waitid(WNOWAIT) is asked for any child that has exited,
+ * and it is collected if it is a job's, so the cost is one call per exit;
+ * only a child that is not a job's, which must be left for the caller,
+ * hides the others behind it: then the pids of the live jobs are copied out
+ * of the index and each is waited for in turn, so the callback may remove
+ * them
+ */
+
+#include "jobtab.h"
+#include "pidmap.h"
+#include <signal.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+struct jobtab {
+    void **jobs;
+    long count;
+    long cap;
+    Pidmap *live;	/* pids of the jobs launched and not done */
+    pid_t *scan;	/* room for every live pid, for jt_reap() */
+    long scan_cap;
+};
+
+JobTab *jt_create(void) {
+    JobTab *t = (JobTab *)calloc(1, sizeof(JobTab));
+
+    if (t == NULL)
+        return NULL;
+    if ((t->live = pm_create()) == NULL) {
+        free(t);
+        return NULL;
+    }
+    return t;
+}
+
+void jt_destroy(JobTab *t) {
+    pm_destroy(t->live);
+    free(t->scan);
+    free(t->jobs);
+    free(t);
+}
+
+int jt_reserve(JobTab *t, long n) {
+    long cap = (t->cap == 0) ? 64 : t->cap;
+    void **jobs;
+
+    if (t->count + n <= t->cap)
+        return 1;
+    while (cap < t->count + n)
+        cap *= 2;
+    if ((jobs = (void **)realloc(t->jobs, cap * sizeof(void *))) == NULL)
+        return 0;
+    t->jobs = jobs;
+    t->cap = cap;
+    return 1;
+}
+
+long jt_add(JobTab *t, void *job) {
+    if (!jt_reserve(t, 1L))
+        return -1L;
+    t->jobs[t->count] = job;
+    return t->count++;
+}
+
+long jt_count(JobTab *t) {
+    return t->count;
+}
+
+void **jt_jobs(JobTab *t) {
+    return t->jobs;
+}
+
+void *jt_get(JobTab *t, long id) {
+    return (id >= 0 && id < t->count) ? t->jobs[id] : NULL;
+}
+
+int jt_launched(JobTab *t, long id, pid_t pid) {
+    if (pm_count(t->live) == t->scan_cap) {
+        long cap = (t->scan_cap == 0) ? 64 : 2 * t->scan_cap;
+        pid_t *scan = (pid_t *)realloc(t->scan, cap * sizeof(pid_t));
+
+        if (scan == NULL)
+            return 0;
+        t->scan = scan;
+        t->scan_cap = cap;
+    }
+    return pm_add(t->live, pid, id);
+}
+
+void jt_done(JobTab *t, pid_t pid) {
+    pm_remove(t->live, pid);
+}
+
+long jt_find(JobTab *t, pid_t pid) {
+    return pm_find(t->live, pid);
+}
+
+long jt_reap(JobTab *t, int flags, void (*fn)(void *ctx, jt_event_t *ev), void *ctx) {
+    jt_event_t ev;
+    siginfo_t info;
+    long events = 0, n, i;
+
+    if (!(flags & JT_ALL)) {
+        for (;;) {
+            info.si_pid = 0;
+            if (waitid(P_ALL, 0, &info, WEXITED | WNOHANG | WNOWAIT) != 0 || info.si_pid == 0)
+                return events;	/* nothing has exited */
+            if ((ev.id = pm_find(t->live, info.si_pid)) < 0)
+                break;		/* the caller's: scan for the jobs' */
+            ev.pid = info.si_pid;
+            ev.pgid = -1;
+            if (wait4(ev.pid, &ev.status, WNOHANG, &ev.ru) != ev.pid)
+                continue;
+            (*fn)(ctx, &ev);
+            events++;
+        }
+        n = pm_list(t->live, t->scan);
+        for (i = 0; i < n; i++) {
+            if (wait4(t->scan[i], &ev.status, WNOHANG, &ev.ru) != t->scan[i])
+                continue;
+            ev.pid = t->scan[i];
+            ev.id = pm_find(t->live, ev.pid);
+            ev.pgid = -1;
+            (*fn)(ctx, &ev);
+            events++;
+        }
+        return events;
+    }
+    info.si_pid = 0;
+    while (waitid(P_ALL, 0, &info, WEXITED | WSTOPPED | WCONTINUED | WNOHANG | WNOWAIT) == 0
+           && info.si_pid != 0) {
+        ev.pid = info.si_pid;
+        ev.pgid = -1;
+        ev.id = pm_find(t->live, ev.pid);
+        if (ev.id < 0 && (flags & JT_GROUPS) && (ev.pgid = getpgid(ev.pid)) != -1)
+            ev.id = pm_find(t->live, ev.pgid);	/* an orphan, still known as a zombie */
+        info.si_pid = 0;
+        if (wait4(ev.pid, &ev.status, WNOHANG | WUNTRACED | WCONTINUED, &ev.ru) != ev.pid)
+            continue;	/* collected meanwhile */
+        (*fn)(ctx, &ev);
+        events++;
+    }
+    return events;
+}
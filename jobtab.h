@@ -0,0 +1,113 @@
+#ifndef _JOBTAB_H_
+#define _JOBTAB_H_
+
+/*
+ * interface definition for the job table and reaper, part of libusps
+ *
+ * the table holds the caller's jobs in submission order, so that a job's
+ * index is its id, and indexes the pids of the jobs that have been launched
+ * and are not done yet (pidmap.h); the reaper collects children and
+ * matches each to its job through that index, so a pid the kernel has
+ * reused is never taken for a finished job
+ *
+ * uspsv3 reaps every child from its SIGCHLD handler, stops and continues
+ * included (JT_ALL); libusps reaps only its own jobs' exits, and leaves the
+ * caller's other children alone
+ *
+ * jt_find(), jt_done() and jt_reap() with JT_ALL neither allocate nor
+ * block, so they may be called from a signal handler, as long as
+ * jt_reserve(), jt_add() and jt_launched() are not running: callers in
+ * signal context block their signals around those
+ */
+
+#include <sys/types.h>
+#include <sys/resource.h>
+
+/* jt_reap() flags */
+#define JT_ALL 1	/* every child, as waitid(P_ALL) sees it, stops and continues included */
+#define JT_GROUPS 2	/* with JT_ALL: a child that is not a job goes to the job leading its process group */
+
+typedef struct jobtab JobTab;		/* opaque type definition */
+
+typedef struct jt_event {
+    pid_t pid;
+    long id;		/* the job of pid (with JT_GROUPS, or of its group), -1 if none */
+    pid_t pgid;		/* JT_GROUPS: pid's process group if pid is not a job's, else -1 */
+    int status;		/* as wait4() returned it: exited, killed, stopped or continued */
+    struct rusage ru;	/* meaningful once the child has terminated */
+} jt_event_t;
+
+/*
+ * creates an empty job table
+ *
+ * returns a pointer to it, or NULL if there are malloc() errors
+ */
+JobTab *jt_create(void);
+
+/*
+ * destroys the table; the jobs themselves belong to the caller
+ */
+void jt_destroy(JobTab *t);
+
+/*
+ * makes sure that `n' more jobs can be added without the table growing
+ *
+ * returns 1 if successful, 0 if unsuccessful (malloc failure)
+ */
+int jt_reserve(JobTab *t, long n);
+
+/*
+ * appends `job' to the table, growing it if need be
+ *
+ * returns its id (0, 1, ... in order), or -1 if there are malloc() errors
+ */
+long jt_add(JobTab *t, void *job);
+
+/*
+ * returns the number of jobs in the table
+ */
+long jt_count(JobTab *t);
+
+/*
+ * returns the table itself, jt_count() pointers indexed by id; it moves
+ * when the table grows
+ */
+void **jt_jobs(JobTab *t);
+
+/*
+ * returns job `id', or NULL if there is no such job
+ */
+void *jt_get(JobTab *t, long id);
+
+/*
+ * records that job `id' runs in process `pid'
+ *
+ * returns 1 if successful, 0 if unsuccessful (malloc failure): the job
+ * cannot be reaped as a job, and should be killed
+ */
+int jt_launched(JobTab *t, long id, pid_t pid);
+
+/*
+ * forgets process `pid' once its job is done
+ */
+void jt_done(JobTab *t, pid_t pid);
+
+/*
+ * returns the id of the job running in process `pid' and not done yet, or
+ * -1 if there is none
+ */
+long jt_find(JobTab *t, pid_t pid);
+
+/*
+ * collects the children that have changed state, without blocking, and
+ * calls fn(ctx, event) for each; without JT_ALL, only the exits of the
+ * jobs running in the processes recorded by jt_launched() are collected
+ * (the callback may call jt_done()), at the cost of a waitid() per exit,
+ * plus a wait4() per live job while the caller has an exited child of its
+ * own that it has not collected yet
+ *
+ * returns the number of events
+ */
+long jt_reap(JobTab *t, int flags, void (*fn)(void *ctx, jt_event_t *ev), void *ctx);
+
+#endif /* _JOBTAB_H_ */
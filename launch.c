@@ -0,0 +1,674 @@
+/*
+ * implementation for the job launch engines
+ *
+ * the forked and cloned children run the same code: wait for SIGUSR1 with
+ * sigwaitinfo(), do the per-job setup, restore the signal dispositions and
+ * mask, and exec(); only async-signal-safe calls are made
+ *
+ * a cloned child does not share the scheduler's memory: with CLONE_VM it
+ * would also share its TLS, so errno, and could write it from setup or a
+ * failed exec() at any point of the scheduler's run, as it waits for many
+ * quanta; it is made by the clone system call with just SIGCHLD, a fork()
+ * that skips the C library's fork handlers
+ *
+ * a zygote request is one SOCK_SEQPACKET message: an ln_request_t followed
+ * by the EOS-terminated strings of argv, of the resolved path and of the
+ * setup's in, out and err (empty for NULL); the reply is an ln_reply_t with
+ * the pidfd attached; the zygote was forked before any command was
+ * resolved, so it execs the path rather than a cached descriptor
+ *
+ * every forked, cloned and zygote child inherits the write end of one
+ * close-on-exec, non-blocking pipe: a successful exec() closes it, a failed
+ * setup or exec() writes an ln_failure_t to it (a single write smaller
+ * than PIPE_BUF, so records never interleave) before the child exits
+ */
+
+#define _GNU_SOURCE
+#include "launch.h"
+#include "p1fxns.h"
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <linux/sched.h>
+#include <sched.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#define LN_REQUEST_MAX (64 * 1024)
+#define LN_ARGS_MAX 1024
+
+extern char **environ;
+
+/* a command resolved by ln_resolve() */
+typedef struct exe {
+    char *name;		/* argv[0] as given */
+    char *path;		/* the file execvp() would run */
+    int fd;			/* open on path, -1 for scripts (see ln_resolve()) */
+} exe_t;
+
+/* what a child execs: a resolved command, or argv[0] searched on PATH */
+typedef struct target {
+    char *path;		/* NULL to search PATH */
+    int fd;
+} target_t;
+
+typedef struct ln_request {
+    int pgroup;
+    int cpu;
+    long nofile;
+    long mem_mb;
+    int argc;
+} ln_request_t;
+
+typedef struct ln_failure {
+    pid_t pid;
+    int err;
+} ln_failure_t;
+
+typedef struct ln_reply {
+    int err;		/* errno value, 0 if the job was created */
+    pid_t pid;
+} ln_reply_t;
+
+static ln_setup_t defaults = {0, -1, 0L, 0L, NULL, NULL, NULL};
+static int server_fd = -1;		/* the scheduler's end of the socketpair */
+static int failures[2] = {-1, -1};	/* the children's failure reports, see above */
+
+/* resolved commands, and an open-addressing hash of their names */
+static exe_t *exes = NULL;
+static int nexes = 0;
+static int *slots = NULL;		/* index into exes, -1 if empty */
+static int nslots = 0;		/* a power of two, at least twice nexes */
+
+void ln_defaults(ln_setup_t *setup) {
+    *setup = defaults;
+}
+
+int ln_engine(char *name) {
+    if (p1strneq(name, "fork", 5))
+        return LN_FORK;
+    if (p1strneq(name, "clone", 6))
+        return LN_CLONE;
+    if (p1strneq(name, "spawn", 6))
+        return LN_SPAWN;
+    if (p1strneq(name, "zygote", 7))
+        return LN_ZYGOTE;
+    return -1;
+}
+
+/*
+ * creates the failure pipe the first time it is needed
+ *
+ * returns 1 if successful, 0 if not
+ */
+static int open_failures(void) {
+    if (failures[0] == -1 && pipe2(failures, O_CLOEXEC | O_NONBLOCK) == -1) {
+        p1perror(2, "Failed to create exec failure pipe");
+        return 0;
+    }
+    return 1;
+}
+
+/*
+ * a child's report that it could not run its command, then its exit
+ */
+static void child_failed(int err) {
+    ln_failure_t f;
+
+    f.pid = getpid();
+    f.err = err;
+    (void)write(failures[1], &f, sizeof(f));	/* the status says it anyway */
+    _exit(LN_FAILED);
+}
+
+static void fail(char *what, char *name, int err) {
+    P1sbuf sb;
+
+    p1sinit(&sb, 2);
+    p1sputstr(&sb, what);
+    p1sputstr(&sb, name);
+    p1sputstr(&sb, " - ");
+    p1sputstr(&sb, strerror(err));
+    p1sputstr(&sb, "\n");
+    p1sflush(&sb);
+}
+
+static int set_limit(int resource, rlim_t value) {
+    struct rlimit rl;
+
+    rl.rlim_cur = rl.rlim_max = value;
+    return setrlimit(resource, &rl) == 0;
+}
+
+static int redirect(char *path, int fd, int flags) {
+    int f = open(path, flags, 0644);
+
+    if (f == -1)
+        return 0;
+    if (f != fd) {
+        if (dup2(f, fd) == -1)
+            return 0;
+        close(f);
+    }
+    return 1;
+}
+
+/*
+ * the per-job setup done by a forked or cloned child
+ */
+static int child_setup(char *name, ln_setup_t *s) {
+    if (s->pgroup && setpgid(0, 0) == -1) {
+        fail("Failed to create process group for ", name, errno);
+        return 0;
+    }
+    if (s->cpu >= 0) {
+        cpu_set_t set;
+
+        CPU_ZERO(&set);
+        CPU_SET(s->cpu, &set);
+        if (sched_setaffinity(0, sizeof(set), &set) == -1) {
+            fail("Failed to set CPU affinity for ", name, errno);
+            return 0;
+        }
+    }
+    if ((s->nofile > 0L && !set_limit(RLIMIT_NOFILE, (rlim_t)s->nofile))
+        || (s->mem_mb > 0L && !set_limit(RLIMIT_AS, (rlim_t)s->mem_mb << 20))) {
+        fail("Failed to set resource limit for ", name, errno);
+        return 0;
+    }
+    if ((s->in != NULL && !redirect(s->in, 0, O_RDONLY))
+        || (s->out != NULL && !redirect(s->out, 1, O_WRONLY | O_CREAT | O_TRUNC))
+        || (s->err != NULL && !redirect(s->err, 2, O_WRONLY | O_CREAT | O_TRUNC))) {
+        fail("Failed to redirect standard I/O for ", name, errno);
+        return 0;
+    }
+    return 1;
+}
+
+/*
+ * the body of a forked or cloned child; never returns
+ */
+static int child_main(char **argv, target_t *target, ln_setup_t *setup) {
+    sigset_t set;
+    siginfo_t info;
+    struct sigaction dfl;
+    int sig, err;
+
+    sigemptyset(&set);
+    sigaddset(&set, SIGUSR1);
+    while (sigwaitinfo(&set, &info) == -1)
+        ;		/* interrupted; keep waiting for the first dispatch */
+    if (!child_setup(argv[0], setup))
+        child_failed(errno);
+    memset(&dfl, 0, sizeof(dfl));
+    dfl.sa_handler = SIG_DFL;
+    for (sig = 1; sig < NSIG; sig++)	/* the scheduler's handlers */
+        (void)sigaction(sig, &dfl, NULL);
+    sigemptyset(&set);
+    sigprocmask(SIG_SETMASK, &set, NULL);
+    if (target->fd != -1)
+        syscall(SYS_execveat, target->fd, "", argv, environ, AT_EMPTY_PATH);
+    else if (target->path != NULL)
+        execv(target->path, argv);
+    else
+        execvp(argv[0], argv);
+    err = errno;
+    fail("Execution failed: ", argv[0], err);
+    child_failed(err);
+    return 1;
+}
+
+static int launch_clone(ln_child_t *child, target_t *target, char **argv,
+                        ln_setup_t *setup) {
+    /* no new stack: the child returns here on a copy of the scheduler's */
+    child->pid = (pid_t)syscall(SYS_clone, (unsigned long)SIGCHLD, NULL, NULL, NULL, 0UL);
+    if (child->pid == -1) {
+        fail("Failed to clone ", argv[0], errno);
+        return 0;
+    }
+    if (child->pid == 0)
+        child_main(argv, target, setup);
+    return 1;
+}
+
+static int launch_spawn(ln_child_t *child, target_t *target, char **argv,
+                        ln_setup_t *setup) {
+    posix_spawnattr_t attr;
+    posix_spawn_file_actions_t actions;
+    sigset_t set;
+    short flags = POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF;
+    int err;
+
+    posix_spawnattr_init(&attr);
+    posix_spawn_file_actions_init(&actions);
+    sigemptyset(&set);
+    posix_spawnattr_setsigmask(&attr, &set);
+    sigfillset(&set);
+    sigdelset(&set, SIGKILL);
+    sigdelset(&set, SIGSTOP);
+    posix_spawnattr_setsigdefault(&attr, &set);
+    if (setup->pgroup) {
+        flags |= POSIX_SPAWN_SETPGROUP;
+        posix_spawnattr_setpgroup(&attr, 0);
+    }
+    posix_spawnattr_setflags(&attr, flags);
+    if (setup->in != NULL)
+        posix_spawn_file_actions_addopen(&actions, 0, setup->in, O_RDONLY, 0);
+    if (setup->out != NULL)
+        posix_spawn_file_actions_addopen(&actions, 1, setup->out,
+                                         O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (setup->err != NULL)
+        posix_spawn_file_actions_addopen(&actions, 2, setup->err,
+                                         O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (target->path != NULL)	/* posix_spawn() has no descriptor form */
+        err = posix_spawn(&child->pid, target->path, &actions, &attr, argv, environ);
+    else
+        err = posix_spawnp(&child->pid, argv[0], &actions, &attr, argv, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attr);
+    if (err != 0) {
+        fail("Execution failed: ", argv[0], err);
+        return 0;
+    }
+    kill(child->pid, SIGSTOP);		/* the gate */
+    if (setup->cpu >= 0) {
+        cpu_set_t cpus;
+
+        CPU_ZERO(&cpus);
+        CPU_SET(setup->cpu, &cpus);
+        if (sched_setaffinity(child->pid, sizeof(cpus), &cpus) == -1)
+            fail("Failed to set CPU affinity for ", argv[0], errno);
+    }
+    if (setup->nofile > 0L || setup->mem_mb > 0L) {
+        struct rlimit rl;
+
+        rl.rlim_cur = rl.rlim_max = (rlim_t)setup->nofile;
+        if (setup->nofile > 0L && prlimit(child->pid, RLIMIT_NOFILE, &rl, NULL) == -1)
+            fail("Failed to set resource limit for ", argv[0], errno);
+        rl.rlim_cur = rl.rlim_max = (rlim_t)setup->mem_mb << 20;
+        if (setup->mem_mb > 0L && prlimit(child->pid, RLIMIT_AS, &rl, NULL) == -1)
+            fail("Failed to set resource limit for ", argv[0], errno);
+    }
+    return 1;
+}
+
+/*
+ * the zygote's side of a request: creates the job as a sibling, i.e. as
+ * a child of the scheduler, and sends back its pid and a pidfd for it
+ */
+static void serve_request(int fd, char *buf, long len) {
+    ln_request_t *req = (ln_request_t *)buf;
+    char *argv[LN_ARGS_MAX + 1], *p = buf + sizeof(ln_request_t), *end = buf + len;
+    char *files[4];
+    target_t target;
+    ln_setup_t setup;
+    ln_reply_t reply = {0, 0};
+    struct clone_args ca;
+    int pidfd = -1, i;
+
+    for (i = 0; i < req->argc + 4; i++) {
+        char *s = p;
+
+        while (p < end && *p != '\0')
+            p++;
+        if (p++ == end)
+            break;		/* truncated */
+        if (i < req->argc)
+            argv[i] = s;
+        else
+            files[i - req->argc] = (*s == '\0') ? NULL : s;
+    }
+    if (req->argc < 1 || req->argc > LN_ARGS_MAX || i < req->argc + 4) {
+        reply.err = EINVAL;
+    } else {
+        argv[req->argc] = NULL;
+        setup.pgroup = req->pgroup;
+        setup.cpu = req->cpu;
+        setup.nofile = req->nofile;
+        setup.mem_mb = req->mem_mb;
+        target.path = files[0];
+        target.fd = -1;
+        setup.in = files[1];
+        setup.out = files[2];
+        setup.err = files[3];
+        memset(&ca, 0, sizeof(ca));
+        ca.flags = CLONE_PARENT | CLONE_PIDFD;
+        ca.pidfd = (uint64_t)(unsigned long)&pidfd;
+        reply.pid = syscall(SYS_clone3, &ca, sizeof(ca));
+        if (reply.pid == 0)
+            child_main(argv, &target, &setup);
+        if (reply.pid == -1)
+            reply.err = errno;
+    }
+    {
+        struct msghdr msg;
+        struct iovec iov;
+        char control[CMSG_SPACE(sizeof(int))];
+
+        memset(&msg, 0, sizeof(msg));
+        iov.iov_base = &reply;
+        iov.iov_len = sizeof(reply);
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        if (pidfd != -1) {
+            struct cmsghdr *cm;
+
+            msg.msg_control = control;
+            msg.msg_controllen = sizeof(control);
+            cm = CMSG_FIRSTHDR(&msg);
+            cm->cmsg_level = SOL_SOCKET;
+            cm->cmsg_type = SCM_RIGHTS;
+            cm->cmsg_len = CMSG_LEN(sizeof(int));
+            memcpy(CMSG_DATA(cm), &pidfd, sizeof(int));
+        }
+        while (sendmsg(fd, &msg, MSG_NOSIGNAL) == -1 && errno == EINTR)
+            ;
+        if (pidfd != -1)
+            close(pidfd);
+    }
+}
+
+int ln_server_start(void) {
+    int sv[2];
+    sigset_t usr1;
+    pid_t pid;
+
+    if (!open_failures())
+        return 0;
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sv) == -1) {
+        p1perror(2, "Failed to create launcher socket");
+        return 0;
+    }
+    pid = fork();
+    if (pid == -1) {
+        p1perror(2, "Failed to fork launcher");
+        close(sv[0]);
+        close(sv[1]);
+        return 0;
+    }
+    if (pid == 0) {
+        static char buf[LN_REQUEST_MAX];
+        long n;
+
+        close(sv[0]);
+        sigemptyset(&usr1);
+        sigaddset(&usr1, SIGUSR1);	/* inherited by the jobs, see launch.h */
+        sigprocmask(SIG_BLOCK, &usr1, NULL);
+        for (;;) {
+            n = recv(sv[1], buf, sizeof(buf), 0);
+            if (n == -1 && errno == EINTR)
+                continue;
+            if (n < (long)sizeof(ln_request_t))
+                _exit(0);	/* the scheduler is gone */
+            serve_request(sv[1], buf, n);
+        }
+    }
+    close(sv[1]);
+    server_fd = sv[0];
+    return 1;
+}
+
+void ln_server_stop(void) {
+    if (server_fd != -1) {
+        close(server_fd);
+        server_fd = -1;
+    }
+}
+
+static char *pack(char *p, char *end, char *s) {
+    if (s == NULL)
+        s = "";
+    while (p != NULL && p < end) {
+        if ((*p++ = *s++) == '\0')
+            return p;
+    }
+    return NULL;
+}
+
+static int launch_zygote(ln_child_t *child, target_t *target, char **argv,
+                         ln_setup_t *setup) {
+    static char buf[LN_REQUEST_MAX];
+    ln_request_t *req = (ln_request_t *)buf;
+    char *p = buf + sizeof(ln_request_t), *end = buf + sizeof(buf);
+    char control[CMSG_SPACE(sizeof(int))];
+    struct msghdr msg;
+    struct iovec iov;
+    struct cmsghdr *cm;
+    ln_reply_t reply;
+    long n;
+
+    if (server_fd == -1) {
+        p1putstr(2, "The launcher has not been started\n");
+        return 0;
+    }
+    req->pgroup = setup->pgroup;
+    req->cpu = setup->cpu;
+    req->nofile = setup->nofile;
+    req->mem_mb = setup->mem_mb;
+    for (req->argc = 0; argv[req->argc] != NULL; req->argc++)
+        p = pack(p, end, argv[req->argc]);
+    p = pack(p, end, target->path);
+    p = pack(pack(pack(p, end, setup->in), end, setup->out), end, setup->err);
+    if (p == NULL || req->argc > LN_ARGS_MAX) {
+        fail("Failed to launch ", argv[0], E2BIG);
+        return 0;
+    }
+    while ((n = send(server_fd, buf, p - buf, MSG_NOSIGNAL)) == -1 && errno == EINTR)
+        ;
+    if (n == -1) {
+        fail("Failed to reach the launcher for ", argv[0], errno);
+        return 0;
+    }
+    memset(&msg, 0, sizeof(msg));
+    iov.iov_base = &reply;
+    iov.iov_len = sizeof(reply);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    while ((n = recvmsg(server_fd, &msg, MSG_CMSG_CLOEXEC)) == -1 && errno == EINTR)
+        ;
+    if (n != (long)sizeof(reply)) {
+        fail("Failed to reach the launcher for ", argv[0], (n == -1) ? errno : EPIPE);
+        return 0;
+    }
+    if (reply.err != 0) {
+        fail("Failed to launch ", argv[0], reply.err);
+        return 0;
+    }
+    child->pid = reply.pid;
+    cm = CMSG_FIRSTHDR(&msg);
+    if (cm != NULL && cm->cmsg_type == SCM_RIGHTS)
+        memcpy(&child->pidfd, CMSG_DATA(cm), sizeof(int));
+    return 1;
+}
+
+static unsigned long hash(char *s) {
+    unsigned long h = 5381;
+
+    while (*s != '\0')
+        h = h * 33 + (unsigned char)*s++;
+    return h;
+}
+
+/*
+ * the file execvp() would run for `name', in a malloc()ed string, or NULL
+ * with errno set
+ */
+static char *search_path(char *name) {
+    char *dirs = getenv("PATH"), *p;
+    int denied = 0;
+
+    if (p1strchr(name, '/') != -1) {
+        if (access(name, X_OK) == -1)
+            return NULL;
+        return p1strdup(name);
+    }
+    if (dirs == NULL)
+        dirs = "/bin:/usr/bin";
+    for (p = dirs; ; p++) {
+        if (*p == ':' || *p == '\0') {
+            int n = p - dirs;
+            char path[n + p1strlen(name) + 3];
+            struct stat st;
+
+            if (n == 0) {
+                p1strcpy(path, ".");	/* an empty entry is the current directory */
+            } else {
+                memcpy(path, dirs, n);
+                path[n] = '\0';
+            }
+            p1strcat(path, "/");
+            p1strcat(path, name);
+            if (stat(path, &st) == 0 && S_ISREG(st.st_mode)) {
+                if (access(path, X_OK) == 0)
+                    return p1strdup(path);
+                denied = 1;
+            }
+            if (*p == '\0')
+                break;
+            dirs = p + 1;
+        }
+    }
+    errno = denied ? EACCES : ENOENT;
+    return NULL;
+}
+
+static int grow_slots(void) {
+    int n = (nslots == 0) ? 64 : 2 * nslots;
+    int *tmp = (int *)malloc(n * sizeof(int));
+    exe_t *etmp = (exe_t *)realloc(exes, (n / 2) * sizeof(exe_t));
+    int i;
+
+    if (etmp != NULL)
+        exes = etmp;
+    if (tmp == NULL || etmp == NULL) {
+        free(tmp);
+        return 0;
+    }
+    for (i = 0; i < n; i++)
+        tmp[i] = -1;
+    for (i = 0; i < nexes; i++) {
+        unsigned long h = hash(exes[i].name) & (n - 1);
+
+        while (tmp[h] != -1)
+            h = (h + 1) & (n - 1);
+        tmp[h] = i;
+    }
+    free(slots);
+    slots = tmp;
+    nslots = n;
+    return 1;
+}
+
+int ln_resolve(char *name) {
+    unsigned long h;
+    exe_t *e;
+    char magic[2];
+
+    if (2 * (nexes + 1) > nslots && !grow_slots()) {
+        errno = ENOMEM;
+        return -1;
+    }
+    for (h = hash(name) & (nslots - 1); slots[h] != -1; h = (h + 1) & (nslots - 1))
+        if (p1strneq(exes[slots[h]].name, name, p1strlen(name) + 1))
+            return slots[h];
+    e = &exes[nexes];
+    if ((e->path = search_path(name)) == NULL)
+        return -1;
+    if ((e->name = p1strdup(name)) == NULL) {
+        free(e->path);
+        errno = ENOMEM;
+        return -1;
+    }
+    /*
+     * a close-on-exec descriptor can't run a script: the interpreter
+     * would be handed /dev/fd/N after it is closed; scripts use the path
+     */
+    e->fd = open(e->path, O_RDONLY | O_CLOEXEC);
+    if (e->fd != -1 && pread(e->fd, magic, 2, 0) == 2 && magic[0] == '#' && magic[1] == '!') {
+        close(e->fd);
+        e->fd = -1;
+    }
+    slots[h] = nexes;
+    return nexes++;
+}
+
+void ln_resolve_clear(void) {
+    int i;
+
+    for (i = 0; i < nexes; i++) {
+        if (exes[i].fd != -1)
+            close(exes[i].fd);
+        free(exes[i].name);
+        free(exes[i].path);
+    }
+    free(exes);
+    free(slots);
+    exes = NULL;
+    slots = NULL;
+    nexes = nslots = 0;
+}
+
+int ln_launch(ln_child_t *child, int engine, int exe, char **argv, ln_setup_t *setup) {
+    target_t target = {NULL, -1};
+
+    if (exe >= 0 && exe < nexes) {
+        target.path = exes[exe].path;
+        target.fd = exes[exe].fd;
+    }
+    if (setup == NULL)
+        setup = &defaults;
+    child->engine = engine;
+    child->pidfd = -1;
+    if (engine != LN_SPAWN && !open_failures())
+        return 0;
+    switch (engine) {
+    case LN_CLONE:
+        return launch_clone(child, &target, argv, setup);
+    case LN_SPAWN:
+        return launch_spawn(child, &target, argv, setup);
+    case LN_ZYGOTE:
+        return launch_zygote(child, &target, argv, setup);
+    default:
+        child->pid = fork();
+        if (child->pid == -1) {
+            fail("Failed to fork ", argv[0], errno);
+            return 0;
+        }
+        if (child->pid == 0)
+            child_main(argv, &target, setup);
+        return 1;
+    }
+}
+
+void ln_start(ln_child_t *child) {
+    if (child->pidfd != -1)		/* cannot hit a recycled pid */
+        syscall(SYS_pidfd_send_signal, child->pidfd, SIGUSR1, NULL, 0);
+    else
+        kill(child->pid, (child->engine == LN_SPAWN) ? SIGCONT : SIGUSR1);
+}
+
+void ln_release(ln_child_t *child) {
+    if (child->pidfd != -1) {
+        close(child->pidfd);
+        child->pidfd = -1;
+    }
+}
+
+void ln_failures(void (*fn)(pid_t pid, int err)) {
+    ln_failure_t f;
+
+    if (failures[0] == -1)
+        return;
+    while (read(failures[0], &f, sizeof(f)) == (long)sizeof(f))
+        (*fn)(f.pid, f.err);
+}
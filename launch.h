@@ -0,0 +1,141 @@
+#ifndef _LAUNCH_H_
+#define _LAUNCH_H_
+
+/*
+ * interface definition for the job launch engines
+ *
+ * a launched job is gated: it exists, but does not run its command until
+ * ln_start() is called for its first dispatch
+ *
+ * LN_FORK   fork()s the scheduler; the child waits for SIGUSR1, then
+ *           exec()s; copying the page tables makes this slower the larger
+ *           the scheduler is
+ * LN_CLONE  clone()s a child with SIGCHLD as the only flag: a fork()
+ *           that runs none of the C library's fork handlers; the child
+ *           waits for SIGUSR1 like a forked one, then exec()s (CLONE_VM
+ *           is not used: the child would share the scheduler's TLS, so its
+ *           errno, while it waits; CLONE_VFORK neither: it would suspend
+ *           the scheduler until the child exec()s, i.e. until its first
+ *           dispatch)
+ * LN_SPAWN  posix_spawnp()s the command and stops it with SIGSTOP as soon
+ *           as posix_spawnp() returns; the gate is approximate, as the
+ *           command may run briefly before it is stopped, and so are the
+ *           CPU affinity and resource limits, which are applied afterwards
+ * LN_ZYGOTE asks a helper process, forked by ln_server_start() while the
+ *           scheduler is still small, to fork the job; the helper creates
+ *           it with CLONE_PARENT, so the job is still the scheduler's child
+ *           (waitpid() and SIGCHLD work as usual), and passes a pidfd for
+ *           it back over the socket; the job is gated like a forked one
+ *
+ * the caller must keep SIGUSR1 blocked, so that the children inherit it
+ * blocked and can wait for it
+ *
+ * a forked, cloned or zygote child that cannot set itself up or exec() its
+ * command exits with status LN_FAILED, and reports why through a
+ * close-on-exec pipe, see ln_failures(); the spawn engine reports such
+ * failures from ln_launch() itself
+ *
+ * commands are resolved once by ln_resolve(), which caches the file found
+ * on PATH and an open descriptor for it; forked, cloned and zygote children
+ * exec() the cached file directly (forked and cloned ones through the
+ * descriptor, with execveat()), so repeated commands skip the PATH search
+ */
+
+#include <sys/types.h>
+
+#define LN_FORK 0
+#define LN_CLONE 1
+#define LN_SPAWN 2
+#define LN_ZYGOTE 3
+
+#define LN_FAILED 127		/* exit status of a child that could not run, as in a shell */
+
+/*
+ * per-job setup done in the child before its command runs
+ */
+typedef struct ln_setup {
+    int pgroup;		/* 1: the job leads a process group of its own */
+    int cpu;		/* the only CPU the job may run on, -1 for any */
+    long nofile;	/* RLIMIT_NOFILE, 0 to inherit */
+    long mem_mb;	/* RLIMIT_AS in MB, 0 to inherit */
+    char *in;		/* file for standard input, NULL to inherit */
+    char *out;		/* file for standard output (truncated), NULL to inherit */
+    char *err;		/* file for standard error (truncated), NULL to inherit */
+} ln_setup_t;
+
+typedef struct ln_child {
+    pid_t pid;
+    int engine;
+    int pidfd;		/* LN_ZYGOTE: refers to the child, until ln_release() */
+} ln_child_t;
+
+/*
+ * fills in `setup' so that the child inherits everything
+ */
+void ln_defaults(ln_setup_t *setup);
+
+/*
+ * returns the engine named `name' ("fork", "clone", "spawn" or "zygote"),
+ * or -1
+ */
+int ln_engine(char *name);
+
+/*
+ * forks the LN_ZYGOTE helper; call it early, before the caller has grown,
+ * opened files or installed signal handlers, as the helper keeps a copy of
+ * all of that; the helper exits when ln_server_stop() is called or the
+ * caller exits
+ *
+ * returns 1 if successful, 0 if not
+ */
+int ln_server_start(void);
+
+/*
+ * tells the LN_ZYGOTE helper to exit
+ */
+void ln_server_stop(void);
+
+/*
+ * resolves command `name' the way execvp() would, once per distinct name
+ *
+ * returns a handle for ln_launch(), or -1 with errno set (ENOENT if it is
+ * not found, EACCES if it is not executable, ENOMEM)
+ */
+int ln_resolve(char *name);
+
+/*
+ * closes the descriptors cached by ln_resolve() and forgets every command
+ */
+void ln_resolve_clear(void);
+
+/*
+ * launches `argv' gated, with `setup' (NULL for the defaults), using
+ * `engine'; `exe' is the handle ln_resolve() returned for argv[0], or -1
+ * to search PATH in the child; `argv' and the strings in `setup' must stay
+ * valid until the job has been reaped
+ *
+ * returns 1 if successful, 0 if not (the reason has been written to
+ * standard error)
+ */
+int ln_launch(ln_child_t *child, int engine, int exe, char **argv, ln_setup_t *setup);
+
+/*
+ * opens the gate of a launched job; async-signal-safe
+ */
+void ln_start(ln_child_t *child);
+
+/*
+ * releases what the launch still holds, once the job has been reaped;
+ * async-signal-safe
+ */
+void ln_release(ln_child_t *child);
+
+/*
+ * calls back for each child that has failed to set itself up or exec() its
+ * command since the last call, with its pid and the errno value; a child
+ * reports before it exits, so a child that has been reaped with status
+ * LN_FAILED has reported by then (unless the pipe was full); async-signal-safe
+ */
+void ln_failures(void (*fn)(pid_t pid, int err));
+
+#endif /* _LAUNCH_H_ */
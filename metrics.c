@@ -0,0 +1,507 @@
+/*
+ * implementation for live scheduler metrics
+ *
+ * a scrape is answered in two steps: the counters are copied while the
+ * caller keeps the dispatcher out (the snapshot callback of mx_serve()),
+ * then the response is formatted and sent from the copy, so that a slow
+ * client holds up neither time slicing nor reaping
+ *
+ * per-job CPU time is kept here as running totals, in a table indexed by
+ * job id that the dispatcher updates as slices start and end; the snapshot
+ * copies the table in one block, and the slice each running job is in is
+ * added to its total when the response is formatted
+ */
+
+#define _GNU_SOURCE
+#include "metrics.h"
+#include "tracer.h"
+#include "p1fxns.h"
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#define MX_BUFSIZE 65536
+
+metrics_t mx;
+
+/* upper bounds of the jitter buckets in nsec; the last bucket is +Inf */
+static long bounds[MX_BUCKETS - 1] = {
+    100000L, 500000L, 1000000L, 2000000L, 5000000L, 10000000L, 50000000L
+};
+
+static int listen_fd = -1;
+static char *sock_path = NULL;
+
+static uint64_t rate_since;	/* start of the current dispatch-rate window */
+static long rate_base;		/* mx.dispatches at rate_since */
+static long rate_milli;		/* dispatches per second, times 1000 */
+
+/* the response is streamed to the client through this buffer */
+static char out[MX_BUFSIZE];
+static int outlen;
+static int client = -1;
+static int family;		/* of the last per-job sample written, see job_family() */
+
+typedef struct job_acct {
+    int pid;
+    int node;		/* of its last slice, -1 before the first */
+    uint64_t since;	/* start of the slice in progress, 0 if none */
+    long cpu_ns;	/* its slices that have ended */
+    long migrations;
+} job_acct_t;
+
+/* the running per-job totals, see mx_reserve() */
+static job_acct_t *accts;
+static long *node_ns;		/* njobs x nnodes, CPU time on each node */
+static long njobs, jobs_cap;
+static int nnodes;
+
+/* the snapshot a scrape is answered from */
+
+typedef struct snap_gang {
+    char *name;
+    long busy_ns;
+    long together_ns;
+} snap_gang_t;
+
+static metrics_t snap;
+static long snap_ready;
+static uint64_t snap_self_ns;
+static uint64_t snap_now;
+static job_acct_t *snap_accts;
+static long *snap_node_ns;
+static long snap_njobs, snap_cap;
+static snap_gang_t *snap_gangs;
+static long snap_ngangs, snap_gangs_cap;
+
+int mx_open(char *path) {
+    struct sockaddr_un addr;
+
+    if (p1strlen(path) >= (int)sizeof(addr.sun_path)) {
+        p1putstr(2, "metrics socket path is too long\n");
+        return 0;
+    }
+    listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd == -1) {
+        p1perror(2, "error creating metrics socket");
+        return 0;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    p1strcpy(addr.sun_path, path);
+    unlink(path);
+    if (bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) == -1
+        || listen(listen_fd, 8) == -1) {
+        p1perror(2, "error binding metrics socket");
+        close(listen_fd);
+        listen_fd = -1;
+        return 0;
+    }
+    fcntl(listen_fd, F_SETFL, O_NONBLOCK);
+    sock_path = path;
+    rate_since = tr_now();
+    return 1;
+}
+
+int mx_fd(void) {
+    return listen_fd;
+}
+
+void mx_slice(long slice_ns, long quantum_ns) {
+    long jitter = slice_ns - quantum_ns;
+    int i;
+
+    if (jitter < 0)
+        jitter = -jitter;
+    for (i = 0; i < MX_BUCKETS - 1 && jitter > bounds[i]; i++)
+        ;
+    mx.jitter[i]++;
+    mx.jitter_count++;
+    mx.jitter_sum_ns += jitter;
+}
+
+void mx_tick(void) {
+    uint64_t now = tr_now();
+    uint64_t elapsed = now - rate_since;
+
+    if (elapsed >= 1000000000ULL) {
+        long d = mx.dispatches;
+
+        rate_milli = (long)((d - rate_base) * 1000000000000LL / elapsed);
+        rate_base = d;
+        rate_since = now;
+    }
+}
+
+static void out_flush(void) {
+    char *p = out;
+
+    while (outlen > 0 && client != -1) {
+        int w = send(client, p, outlen, MSG_NOSIGNAL);
+
+        if (w < 0 && errno == EINTR)
+            continue;		/* a time slice ended */
+        if (w <= 0)
+            break;		/* client went away; drop the rest */
+        p += w;
+        outlen -= w;
+    }
+    outlen = 0;
+}
+
+static void out_str(char *s) {
+    while (*s != '\0') {
+        if (outlen == MX_BUFSIZE)
+            out_flush();
+        out[outlen++] = *s++;
+    }
+}
+
+static void out_long(long n) {
+    char buf[25];
+
+    p1ltoa(n, buf);
+    out_str(buf);
+}
+
+/*
+ * writes `n' / 10^`digits' with `digits' decimals
+ */
+static void out_fixed(long n, int digits, long scale) {
+    char frac[25];
+    char buf[25];
+
+    out_long(n / scale);
+    out_str(".");
+    p1ltoa(n % scale, frac);
+    p1strpack(frac, -digits, '0', buf);
+    out_str(buf);
+}
+
+static void out_seconds(long ns) {
+    out_fixed(ns, 9, 1000000000L);
+}
+
+static void out_metric(char *name, char *type, char *help, long value) {
+    out_str("# HELP ");
+    out_str(name);
+    out_str(" ");
+    out_str(help);
+    out_str("\n# TYPE ");
+    out_str(name);
+    out_str(" ");
+    out_str(type);
+    out_str("\n");
+    out_str(name);
+    out_str(" ");
+    out_long(value);
+    out_str("\n");
+}
+
+static void out_histogram(void) {
+    long cum = 0;
+    int i;
+
+    out_str("# HELP usps_slice_jitter_seconds |time slice - quantum|\n");
+    out_str("# TYPE usps_slice_jitter_seconds histogram\n");
+    for (i = 0; i < MX_BUCKETS; i++) {
+        cum += snap.jitter[i];
+        out_str("usps_slice_jitter_seconds_bucket{le=\"");
+        if (i < MX_BUCKETS - 1)
+            out_seconds(bounds[i]);
+        else
+            out_str("+Inf");
+        out_str("\"} ");
+        out_long(cum);
+        out_str("\n");
+    }
+    out_str("usps_slice_jitter_seconds_sum ");
+    out_seconds(snap.jitter_sum_ns);
+    out_str("\nusps_slice_jitter_seconds_count ");
+    out_long(snap.jitter_count);
+    out_str("\n");
+}
+
+/*
+ * writes the HELP and TYPE lines of per-job family `f' before its first
+ * sample; the samples of a family must not be interleaved with another's
+ */
+static void job_family(int f, char *name, char *type, char *help) {
+    if (family == f)
+        return;
+    family = f;
+    out_str("# HELP ");
+    out_str(name);
+    out_str(" ");
+    out_str(help);
+    out_str("\n# TYPE ");
+    out_str(name);
+    out_str(" ");
+    out_str(type);
+    out_str("\n");
+}
+
+/*
+ * makes room for one more entry in a snapshot array of `size'-byte entries
+ */
+static int grow(void **array, long *cap, long n, size_t size) {
+    long c = (*cap == 0) ? 64 : 2 * *cap;
+    void *tmp;
+
+    if (n < *cap)
+        return 1;
+    if ((tmp = realloc(*array, c * size)) == NULL)
+        return 0;	/* the sample is left out of this scrape */
+    *array = tmp;
+    *cap = c;
+    return 1;
+}
+
+int mx_reserve(long n, int nodes) {
+    job_acct_t *a;
+    long *ns;
+
+    if (listen_fd == -1 || n <= jobs_cap)
+        return 1;
+    if ((a = (job_acct_t *)realloc(accts, n * sizeof(job_acct_t))) == NULL)
+        return 0;
+    accts = a;
+    if (nodes > 0) {
+        if ((ns = (long *)realloc(node_ns, n * nodes * sizeof(long))) == NULL)
+            return 0;
+        node_ns = ns;
+    }
+    nnodes = nodes;
+    jobs_cap = n;
+    return 1;
+}
+
+void mx_job_add(int job) {
+    int i;
+
+    if (job >= jobs_cap)
+        return;
+    accts[job].pid = 0;
+    accts[job].node = -1;
+    accts[job].since = 0;
+    accts[job].cpu_ns = accts[job].migrations = 0;
+    for (i = 0; i < nnodes; i++)
+        node_ns[(long)job * nnodes + i] = 0;
+    njobs = job + 1;
+}
+
+void mx_job_pid(int job, int pid) {
+    if (job < njobs)
+        accts[job].pid = pid;
+}
+
+void mx_job_run(int job, int node, uint64_t now) {
+    if (job >= njobs)
+        return;
+    if (accts[job].node != -1 && accts[job].node != node)
+        accts[job].migrations++;
+    accts[job].node = node;
+    accts[job].since = now;
+}
+
+void mx_job_stop(int job, long ran) {
+    if (job >= njobs)
+        return;
+    accts[job].cpu_ns += ran;
+    if (nnodes > 0)
+        node_ns[(long)job * nnodes + accts[job].node] += ran;
+    accts[job].since = 0;
+}
+
+void mx_snapshot(long ready) {
+    struct rusage ru;
+
+    snap = mx;
+    snap_ready = ready;
+    snap_now = tr_now();
+    getrusage(RUSAGE_SELF, &ru);
+    snap_self_ns = (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000000L
+                   + (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) * 1000L;
+    snap_ngangs = 0;
+    snap_njobs = 0;
+    if (snap_cap < jobs_cap) {
+        job_acct_t *a = (job_acct_t *)realloc(snap_accts, jobs_cap * sizeof(job_acct_t));
+        long *ns = (nnodes == 0) ? NULL : (long *)realloc(snap_node_ns, jobs_cap * nnodes * sizeof(long));
+
+        if (a != NULL)
+            snap_accts = a;
+        if (ns != NULL)
+            snap_node_ns = ns;
+        if (a == NULL || (nnodes > 0 && ns == NULL))
+            return;	/* the per-job samples are left out of this scrape */
+        snap_cap = jobs_cap;
+    }
+    memcpy(snap_accts, accts, njobs * sizeof(job_acct_t));
+    if (nnodes > 0)
+        memcpy(snap_node_ns, node_ns, njobs * nnodes * sizeof(long));
+    snap_njobs = njobs;
+}
+
+/*
+ * finds the snapshot entry of gang `name', adding it if need be
+ */
+static snap_gang_t *snap_gang(char *name) {
+    if (snap_ngangs > 0 && snap_gangs[snap_ngangs - 1].name == name)
+        return &snap_gangs[snap_ngangs - 1];
+    if (!grow((void **)&snap_gangs, &snap_gangs_cap, snap_ngangs, sizeof(snap_gang_t)))
+        return NULL;
+    snap_gangs[snap_ngangs].name = name;
+    snap_gangs[snap_ngangs].busy_ns = snap_gangs[snap_ngangs].together_ns = 0;
+    return &snap_gangs[snap_ngangs++];
+}
+
+void mx_gang_busy(char *gang, long ns) {
+    snap_gang_t *g = snap_gang(gang);
+
+    if (g != NULL)
+        g->busy_ns = ns;
+}
+
+void mx_gang_together(char *gang, long ns) {
+    long i;
+
+    for (i = 0; i < snap_ngangs; i++) {
+        if (snap_gangs[i].name == gang)
+            snap_gangs[i].together_ns = ns;
+    }
+}
+
+/*
+ * returns a job's CPU time as of the snapshot, on node `node' (-1 for all
+ * of them), the slice it is in included
+ */
+static long snap_cpu(long job, int node) {
+    job_acct_t *a = &snap_accts[job];
+    long ns = (node == -1) ? a->cpu_ns : snap_node_ns[job * nnodes + node];
+
+    if (a->since != 0 && snap_now > a->since && (node == -1 || node == a->node))
+        ns += (long)(snap_now - a->since);
+    return ns;
+}
+
+/*
+ * writes the per-job and per-gang samples of the snapshot
+ */
+static void out_jobs(void) {
+    long i, ns;
+    int n;
+
+    family = 0;
+    for (i = 0; i < snap_njobs; i++) {
+        job_family(1, "usps_job_cpu_seconds_total", "counter", "time each job held a CPU slot");
+        out_str("usps_job_cpu_seconds_total{job=\"");
+        out_long(i);
+        out_str("\",pid=\"");
+        out_long(snap_accts[i].pid);
+        out_str("\"} ");
+        out_seconds(snap_cpu(i, -1));
+        out_str("\n");
+    }
+    for (i = 0; i < snap_ngangs; i++) {
+        job_family(4, "usps_gang_busy_seconds_total", "counter",
+                   "time at least one member of each gang held a CPU slot");
+        out_str("usps_gang_busy_seconds_total{gang=\"");
+        out_str(snap_gangs[i].name);
+        out_str("\"} ");
+        out_seconds(snap_gangs[i].busy_ns);
+        out_str("\n");
+    }
+    for (i = 0; i < snap_ngangs; i++) {
+        job_family(5, "usps_gang_coscheduled_seconds_total", "counter",
+                   "time every runnable member of each gang held a CPU slot at once");
+        out_str("usps_gang_coscheduled_seconds_total{gang=\"");
+        out_str(snap_gangs[i].name);
+        out_str("\"} ");
+        out_seconds(snap_gangs[i].together_ns);
+        out_str("\n");
+    }
+    if (nnodes == 0)
+        return;
+    for (i = 0; i < snap_njobs; i++) {
+        for (n = 0; n < nnodes; n++) {
+            if ((ns = snap_cpu(i, n)) == 0)
+                continue;
+            job_family(2, "usps_job_node_cpu_seconds_total", "counter",
+                       "time each job held a CPU slot on each NUMA node");
+            out_str("usps_job_node_cpu_seconds_total{job=\"");
+            out_long(i);
+            out_str("\",node=\"");
+            out_long(n);
+            out_str("\"} ");
+            out_seconds(ns);
+            out_str("\n");
+        }
+    }
+    for (i = 0; i < snap_njobs; i++) {
+        job_family(3, "usps_job_migrations_total", "counter",
+                   "times each job ran on another NUMA node than the time before");
+        out_str("usps_job_migrations_total{job=\"");
+        out_long(i);
+        out_str("\"} ");
+        out_long(snap_accts[i].migrations);
+        out_str("\n");
+    }
+}
+
+void mx_serve(void (*snapshot)(void)) {
+    char req[1024];
+    struct timeval tv = {0, 100000};	/* a silent client can't stall the loop */
+
+    if (listen_fd == -1 || (client = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC)) == -1)
+        return;
+    setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    (void)read(client, req, sizeof(req));	/* the request itself is not needed */
+    (*snapshot)();
+    outlen = 0;
+    out_str("HTTP/1.0 200 OK\r\n"
+            "Content-Type: text/plain; version=0.0.4\r\n\r\n");
+    out_metric("usps_jobs_total", "gauge", "jobs in the workload", snap.jobs_total);
+    out_metric("usps_jobs_running", "gauge", "jobs holding a CPU slot", snap.running);
+    out_metric("usps_jobs_ready", "gauge", "jobs on the ready queue", snap_ready);
+    out_metric("usps_jobs_finished_total", "counter", "jobs that terminated",
+               snap.jobs_finished);
+    out_metric("usps_dispatches_total", "counter", "time slices handed out",
+               snap.dispatches);
+    out_str("# HELP usps_dispatches_per_second dispatch rate over the last second\n"
+            "# TYPE usps_dispatches_per_second gauge\nusps_dispatches_per_second ");
+    out_fixed(rate_milli, 3, 1000L);
+    out_str("\n");
+    out_histogram();
+    out_metric("usps_throttled", "gauge",
+               "1 while memory/cpu/io pressure holds back admission", snap.throttled);
+    out_str("# HELP usps_throttled_seconds_total time spent throttled by pressure\n"
+            "# TYPE usps_throttled_seconds_total counter\n"
+            "usps_throttled_seconds_total ");
+    out_seconds(snap.throttled_ns);
+    out_str("\n");
+    out_str("# HELP usps_scheduler_cpu_seconds_total CPU used by the scheduler itself\n"
+            "# TYPE usps_scheduler_cpu_seconds_total counter\n"
+            "usps_scheduler_cpu_seconds_total ");
+    out_seconds(snap_self_ns);
+    out_str("\n");
+    out_jobs();
+    out_flush();
+    close(client);
+    client = -1;
+}
+
+void mx_close(void) {
+    if (listen_fd == -1)
+        return;
+    close(listen_fd);
+    unlink(sock_path);
+    listen_fd = -1;
+}
@@ -0,0 +1,107 @@
+#ifndef _METRICS_H_
+#define _METRICS_H_
+
+/*
+ * interface definition for live scheduler metrics
+ *
+ * the dispatcher updates preaggregated counters as it works (the update
+ * functions are async-signal-safe and O(1)); a scrape of the Unix domain
+ * socket opened by mx_open() is answered from the scheduler's main loop with
+ * an HTTP/1.0 response in the Prometheus text exposition format, e.g.
+ *
+ *	curl --unix-socket /tmp/usps.sock http://localhost/metrics
+ */
+
+#include <stdint.h>
+
+#define MX_BUCKETS 8	/* slice jitter histogram, see metrics.c */
+
+typedef struct metrics {
+    long jobs_total;
+    long jobs_finished;
+    long running;
+    long dispatches;
+    long jitter[MX_BUCKETS];	/* per bucket, not cumulative */
+    long jitter_count;
+    long jitter_sum_ns;		/* sum of |slice - quantum| */
+    long throttled;		/* 1 while the pressure governor holds back jobs */
+    long throttled_ns;		/* total time it has done so */
+} metrics_t;
+
+extern metrics_t mx;
+
+/*
+ * creates the listening socket `path', replacing a stale socket file
+ *
+ * returns 1 if successful, 0 if not
+ */
+int mx_open(char *path);
+
+/*
+ * returns the listening socket, or -1 if metrics are disabled
+ */
+int mx_fd(void);
+
+/*
+ * records one completed time slice of `slice_ns' against a quantum of
+ * `quantum_ns'; async-signal-safe
+ */
+void mx_slice(long slice_ns, long quantum_ns);
+
+/*
+ * updates the dispatch rate; called from the main loop at least once a
+ * second
+ */
+void mx_tick(void);
+
+/*
+ * makes room for the CPU time of jobs 0 .. n-1, on each of `nodes' NUMA
+ * nodes (0 to keep no per-node times; the same on every call); does
+ * nothing if metrics are disabled
+ *
+ * returns 1 if successful, 0 if not (malloc failure)
+ */
+int mx_reserve(long n, int nodes);
+
+/*
+ * record a job's CPU time as the dispatcher works, for jobs that room has
+ * been made for: mx_job_add() starts job `job' from zero, mx_job_pid() gives
+ * it its process, mx_job_run() starts one of its slices on `node' at `now'
+ * (tr_now() time), and mx_job_stop() ends it, `ran' nsec later;
+ * async-signal-safe and O(1)
+ */
+void mx_job_add(int job);
+void mx_job_pid(int job, int pid);
+void mx_job_run(int job, int node, uint64_t now);
+void mx_job_stop(int job, long ran);
+
+/*
+ * accepts one pending scrape and answers it; `snapshot' is called back
+ * once the request has been read, and must call mx_snapshot(), then report
+ * each gang through mx_gang_busy() and mx_gang_together(), while keeping
+ * the dispatcher out; the response is formatted and sent from that copy
+ * after it returns
+ */
+void mx_serve(void (*snapshot)(void));
+
+/*
+ * copies the counters above and every job's CPU time for the scrape being
+ * served; `ready' is the current length of the ready queue. only valid
+ * inside the `snapshot' callback of mx_serve()
+ */
+void mx_snapshot(long ready);
+
+/*
+ * report the time at least one member of a gang has held a CPU slot, and the
+ * part of it during which every runnable member did; as mx_snapshot(), after
+ * it, and a gang's mx_gang_busy() comes before its mx_gang_together()
+ */
+void mx_gang_busy(char *gang, long ns);
+void mx_gang_together(char *gang, long ns);
+
+/*
+ * closes the listening socket and removes the socket file
+ */
+void mx_close(void);
+
+#endif /* _METRICS_H_ */
@@ -8,6 +8,7 @@
 #include "p1fxns.h"
 #include <string.h>
 #include <errno.h>
+#include <sys/uio.h>
 
 /*
  *	p1getline - return EOS-terminated character array from fd
@@ -118,39 +119,52 @@ char *p1strdup(char *s) {
 }
 
 /*
- *	p1putint - display integer in decimal on file descriptor
+ *	writes the `n' buffers in `iov' completely, retrying short writes
+ *	and interrupted calls; only uses writev(), so it is async-signal-safe
  */
-static char *digits = "0123456789";
+static void writev_all(int fd, struct iovec *iov, int n) {
+    while (n > 0) {
+        ssize_t w = writev(fd, iov, n);
+
+        if (w < 0 && errno == EINTR)
+            continue;
+        if (w <= 0)
+            return;		/* nowhere to report it; drop the rest */
+        while (n > 0 && (size_t)w >= iov->iov_len) {
+            w -= iov->iov_len;
+            iov++;
+            n--;
+        }
+        if (n > 0) {
+            iov->iov_base = (char *)iov->iov_base + w;
+            iov->iov_len -= w;
+        }
+    }
+}
+
+static void write_all(int fd, char *buf, int n) {
+    struct iovec iov;
 
+    iov.iov_base = buf;
+    iov.iov_len = n;
+    writev_all(fd, &iov, 1);
+}
+
+/*
+ *	p1putint - display integer in decimal on file descriptor
+ */
 void p1putint(int fd, int number) {
     char buf[25];
-    int n, i;
 
-    if (number == 0) {
-        buf[0] = '0';
-        i = 1;
-    } else {
-        for (n = number, i = 0; n != 0; i++) {
-            buf[i] = digits[n % 10];
-            n /= 10;
-        }
-    }
-    while (--i >= 0)
-        write(fd, buf+i, 1);
-    fsync(fd);
+    p1itoa(number, buf);
+    write_all(fd, buf, p1strlen(buf));
 }
 
 /*
  *	p1putstr - display string on file descriptor
  */
 void p1putstr(int fd, char *s) {
-    int n = p1strlen(s);
-    write(fd, s, n);
-    //while (*s != '\0') {
-        //write(fd, s, 1);
-        //s++;
-    //}
-    fsync(fd);
+    write_all(fd, s, p1strlen(s));
 }
 
 /*
@@ -160,11 +174,156 @@ void p1putstr(int fd, char *s) {
  */
 void p1perror(int fd, char *str) {
     char *p = strerror(errno);
+    struct iovec iov[4];
+
+    iov[0].iov_base = str;
+    iov[0].iov_len = p1strlen(str);
+    iov[1].iov_base = " - ";
+    iov[1].iov_len = 3;
+    iov[2].iov_base = p;
+    iov[2].iov_len = p1strlen(p);
+    iov[3].iov_base = "\n";
+    iov[3].iov_len = 1;
+    writev_all(fd, iov, 4);
+}
+
+/*
+ *	buffered output - one buffer for each of the first P1_BUFFERED_FDS
+ *	descriptors written through p1bputstr(); a descriptor that finds no
+ *	free buffer is written through directly
+ */
+#define P1_BUFFERED_FDS 4
+#define P1_BUFSIZE 4096
+
+static struct outbuf {
+    int fd;			/* -1 if the slot is free */
+    int lines;		/* flush at each newline (a terminal) */
+    int len;
+    char buf[P1_BUFSIZE];
+} outbufs[P1_BUFFERED_FDS] = {{-1, 0, 0, {0}}, {-1, 0, 0, {0}},
+                              {-1, 0, 0, {0}}, {-1, 0, 0, {0}}};
+
+static void flush_at_exit(void) {
+    p1bflush(-1);
+}
+
+static struct outbuf *outbuf_of(int fd) {
+    static int registered = 0;
+    int i;
+
+    for (i = 0; i < P1_BUFFERED_FDS; i++)
+        if (outbufs[i].fd == fd)
+            return &outbufs[i];
+    for (i = 0; i < P1_BUFFERED_FDS; i++) {
+        if (outbufs[i].fd == -1) {
+            if (!registered && atexit(flush_at_exit) != 0)
+                return NULL;
+            registered = 1;
+            outbufs[i].fd = fd;
+            outbufs[i].lines = isatty(fd);
+            outbufs[i].len = 0;
+            return &outbufs[i];
+        }
+    }
+    return NULL;
+}
+
+/*
+ *	p1bputstr - append string to the buffer for file descriptor
+ */
+void p1bputstr(int fd, char *s) {
+    struct outbuf *ob = outbuf_of(fd);
+    int n = p1strlen(s);
+
+    if (ob == NULL) {
+        write_all(fd, s, n);
+        return;
+    }
+    if (ob->len + n > P1_BUFSIZE) {
+        /* the buffer and the string leave in a single call, uncopied */
+        struct iovec iov[2];
+
+        iov[0].iov_base = ob->buf;
+        iov[0].iov_len = ob->len;
+        iov[1].iov_base = s;
+        iov[1].iov_len = n;
+        writev_all(fd, iov, 2);
+        ob->len = 0;
+        return;
+    }
+    memcpy(ob->buf + ob->len, s, n);
+    ob->len += n;
+    if (ob->lines && n > 0 && s[n - 1] == '\n')
+        p1bflush(fd);
+}
+
+/*
+ *	p1bputint - append integer in decimal to the buffer for file descriptor
+ */
+void p1bputint(int fd, int number) {
+    char buf[25];
+
+    p1itoa(number, buf);
+    p1bputstr(fd, buf);
+}
+
+/*
+ *	p1bputlong - append long integer in decimal to the buffer for file
+ *	descriptor
+ */
+void p1bputlong(int fd, long number) {
+    char buf[25];
 
-    p1putstr(fd, str);
-    p1putstr(fd, " - ");
-    p1putstr(fd, p);
-    p1putstr(fd, "\n");
+    p1ltoa(number, buf);
+    p1bputstr(fd, buf);
+}
+
+/*
+ *	p1bflush - write out the buffer for file descriptor, or all buffers
+ *	if fd is -1
+ */
+void p1bflush(int fd) {
+    int i;
+
+    for (i = 0; i < P1_BUFFERED_FDS; i++) {
+        struct outbuf *ob = &outbufs[i];
+
+        if (ob->fd == -1 || (fd != -1 && ob->fd != fd))
+            continue;
+        if (ob->len > 0)
+            write_all(ob->fd, ob->buf, ob->len);
+        ob->len = 0;
+    }
+}
+
+/*
+ *	p1sinit, p1sputstr, p1sputlong, p1sflush - async-signal-safe output
+ *	through a caller-provided (usually automatic) P1sbuf
+ */
+void p1sinit(P1sbuf *sb, int fd) {
+    sb->fd = fd;
+    sb->len = 0;
+}
+
+void p1sputstr(P1sbuf *sb, char *s) {
+    while (*s != '\0') {
+        if (sb->len == P1_SBUFSIZE)
+            p1sflush(sb);
+        sb->buf[sb->len++] = *s++;
+    }
+}
+
+void p1sputlong(P1sbuf *sb, long number) {
+    char buf[25];
+
+    p1ltoa(number, buf);
+    p1sputstr(sb, buf);
+}
+
+void p1sflush(P1sbuf *sb) {
+    if (sb->len > 0)
+        write_all(sb->fd, sb->buf, sb->len);
+    sb->len = 0;
 }
 
 /*
@@ -209,6 +368,40 @@ void p1itoa(int number, char *buf) {
     *buf = '\0';
 }
 
+/*
+ *	p1ltoa - format long integer as decimal string
+ */
+void p1ltoa(long number, char *buf) {
+    char tmp[25];
+    unsigned long n;
+    int i, negative;
+    static char digits[] = "0123456789";
+
+    if (number == 0) {
+        tmp[0] = '0';
+        i = 1;
+    } else {
+        if (number < 0) {
+            negative = 1;
+            n = -(unsigned long)number;
+        } else {
+            negative = 0;
+            n = number;
+        }
+        for (i = 0; n != 0; i++) {
+            tmp[i] = digits[n % 10];
+            n /= 10;
+        }
+        if (negative) {
+            tmp[i] = '-';
+            i++;
+        }
+    }
+    while (--i >= 0)
+       *buf++ = tmp[i];
+    *buf = '\0';
+}
+
 /*
  *	p1strcpy - copy str2 into str1
  */
@@ -43,6 +43,10 @@ char *p1strdup(char *s);
 
 /*
  *	p1putint - display integer in decimal on file descriptor
+ *
+ *	p1putint(), p1putstr() and p1perror() each issue a single unbuffered
+ *	write and never fsync(); they are async-signal-safe except for the
+ *	strerror() call in p1perror()
  */
 void p1putint(int fd, int number);
 
@@ -58,6 +62,53 @@ void p1putstr(int fd, char *s);
  */
 void p1perror(int fd, char *str);
 
+/*
+ *	p1bputstr - append string to the output buffer for file descriptor
+ *
+ *	the buffer is written with a single writev() when it would overflow,
+ *	at each newline if fd is a terminal, on p1bflush(), and at exit();
+ *	output written with p1putstr() to the same fd is not ordered with it
+ *
+ *	N.B. not async-signal-safe; in signal handlers and in a child between
+ *	fork() and exec() use a P1sbuf instead
+ */
+void p1bputstr(int fd, char *s);
+
+/*
+ *	p1bputint - append integer in decimal to the output buffer for fd
+ */
+void p1bputint(int fd, int number);
+
+/*
+ *	p1bputlong - append long integer in decimal to the output buffer for fd
+ */
+void p1bputlong(int fd, long number);
+
+/*
+ *	p1bflush - write out the output buffer for fd, or every buffer if fd
+ *	is -1
+ */
+void p1bflush(int fd);
+
+/*
+ *	P1sbuf - async-signal-safe output buffer, normally an automatic
+ *	variable of a signal handler: p1sinit() binds it to fd, p1sputstr()
+ *	and p1sputlong() append to it, and p1sflush() writes it out with a
+ *	single write(); it only flushes earlier by itself if it fills up
+ */
+#define P1_SBUFSIZE 256
+
+typedef struct p1sbuf {
+    int fd;
+    int len;
+    char buf[P1_SBUFSIZE];
+} P1sbuf;
+
+void p1sinit(P1sbuf *sb, int fd);
+void p1sputstr(P1sbuf *sb, char *s);
+void p1sputlong(P1sbuf *sb, long number);
+void p1sflush(P1sbuf *sb);
+
 /*
  *	p1atoi - convert string to integer
  */
@@ -68,6 +119,11 @@ int p1atoi(char *s);
  */
 void p1itoa(int number, char *buf);
 
+/*
+ *	p1ltoa - format long integer as decimal string
+ */
+void p1ltoa(long number, char *buf);
+
 /*
  *	p1strcpy - copy str2 into str1
  */
@@ -0,0 +1,130 @@
+/*
+ * implementation for the pid index of live jobs
+ *
+ * open addressing with linear probing; removal shifts the entries of the
+ * same run back instead of leaving tombstones, so a long run of jobs that
+ * come and go never degrades the probes, and nothing is rehashed outside
+ * of pm_add()
+ */
+
+#include "pidmap.h"
+#include <stdint.h>
+#include <stdlib.h>
+
+#define PM_MIN_SLOTS 64
+
+typedef struct entry {
+    pid_t pid;		/* 0 if the slot is empty */
+    long id;
+} entry_t;
+
+struct pidmap {
+    entry_t *slots;
+    long nslots;	/* a power of two, at least twice count */
+    long count;
+};
+
+static long home(Pidmap *pm, pid_t pid) {
+    return (long)(((uint32_t)pid * 2654435761U) & (uint32_t)(pm->nslots - 1));
+}
+
+Pidmap *pm_create(void) {
+    Pidmap *pm = (Pidmap *)malloc(sizeof(Pidmap));
+
+    if (pm == NULL)
+        return NULL;
+    if ((pm->slots = (entry_t *)calloc(PM_MIN_SLOTS, sizeof(entry_t))) == NULL) {
+        free(pm);
+        return NULL;
+    }
+    pm->nslots = PM_MIN_SLOTS;
+    pm->count = 0;
+    return pm;
+}
+
+void pm_destroy(Pidmap *pm) {
+    free(pm->slots);
+    free(pm);
+}
+
+/*
+ * the slot holding `pid', or the empty slot where it would go
+ */
+static long probe(Pidmap *pm, pid_t pid) {
+    long i = home(pm, pid);
+
+    while (pm->slots[i].pid != 0 && pm->slots[i].pid != pid)
+        i = (i + 1) & (pm->nslots - 1);
+    return i;
+}
+
+static int grow(Pidmap *pm) {
+    entry_t *old = pm->slots;
+    long n = pm->nslots, i;
+
+    if ((pm->slots = (entry_t *)calloc(2 * n, sizeof(entry_t))) == NULL) {
+        pm->slots = old;
+        return 0;
+    }
+    pm->nslots = 2 * n;
+    for (i = 0; i < n; i++) {
+        if (old[i].pid != 0)
+            pm->slots[probe(pm, old[i].pid)] = old[i];
+    }
+    free(old);
+    return 1;
+}
+
+int pm_add(Pidmap *pm, pid_t pid, long id) {
+    long i;
+
+    if (2 * (pm->count + 1) > pm->nslots && !grow(pm))
+        return 0;
+    i = probe(pm, pid);
+    if (pm->slots[i].pid == 0)
+        pm->count++;
+    pm->slots[i].pid = pid;
+    pm->slots[i].id = id;
+    return 1;
+}
+
+void pm_remove(Pidmap *pm, pid_t pid) {
+    long mask = pm->nslots - 1, i = probe(pm, pid), j;
+
+    if (pm->slots[i].pid == 0)
+        return;
+    pm->count--;
+    /* move back each later entry of the run that may no longer be reached */
+    for (j = (i + 1) & mask; pm->slots[j].pid != 0; j = (j + 1) & mask) {
+        long h = home(pm, pm->slots[j].pid);
+
+        if (((j - h) & mask) >= ((j - i) & mask)) {
+            pm->slots[i] = pm->slots[j];
+            i = j;
+        }
+    }
+    pm->slots[i].pid = 0;
+}
+
+long pm_find(Pidmap *pm, pid_t pid) {
+    long i;
+
+    if (pid <= 0)
+        return -1L;
+    i = probe(pm, pid);
+    return (pm->slots[i].pid == pid) ? pm->slots[i].id : -1L;
+}
+
+long pm_count(Pidmap *pm) {
+    return pm->count;
+}
+
+long pm_list(Pidmap *pm, pid_t *pids) {
+    long i, n = 0;
+
+    for (i = 0; i < pm->nslots; i++) {
+        if (pm->slots[i].pid != 0)
+            pids[n++] = pm->slots[i].pid;
+    }
+    return n;
+}
@@ -0,0 +1,64 @@
+#ifndef _PIDMAP_H_
+#define _PIDMAP_H_
+
+/*
+ * interface definition for the pid index of live jobs
+ *
+ * maps the pid of each job that has been launched and not yet reaped to the
+ * job's id, so that a reaped child is matched to its job in O(1) however
+ * many jobs have run; a job is removed once it is done, so a pid the kernel
+ * reuses is never matched to a finished job
+ *
+ * pm_remove() and pm_find() neither allocate nor block, so they may be
+ * called from a signal handler, as long as pm_add() is not running: callers
+ * in signal context block their signals around pm_add()
+ */
+
+#include <sys/types.h>
+
+typedef struct pidmap Pidmap;		/* opaque type definition */
+
+/*
+ * creates an empty index
+ *
+ * returns a pointer to it, or NULL if there are malloc() errors
+ */
+Pidmap *pm_create(void);
+
+/*
+ * destroys the index
+ */
+void pm_destroy(Pidmap *pm);
+
+/*
+ * maps `pid' to job `id', replacing any entry for it; grows the table
+ * when it is half full
+ *
+ * returns 1 if successful, 0 if unsuccessful (malloc failure)
+ */
+int pm_add(Pidmap *pm, pid_t pid, long id);
+
+/*
+ * removes the entry for `pid', if any
+ */
+void pm_remove(Pidmap *pm, pid_t pid);
+
+/*
+ * returns the id mapped to `pid', or -1 if there is none
+ */
+long pm_find(Pidmap *pm, pid_t pid);
+
+/*
+ * returns the number of pids in the index
+ */
+long pm_count(Pidmap *pm);
+
+/*
+ * writes every pid in the index to `pids', which has room for pm_count()
+ * of them, in no particular order
+ *
+ * returns the number written
+ */
+long pm_list(Pidmap *pm, pid_t *pids);
+
+#endif /* _PIDMAP_H_ */
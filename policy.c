@@ -0,0 +1,200 @@
+/*
+ * implementation for the ready-queue policy
+ *
+ * the ready queue is ordered on (priority, deadline, rank, sequence number),
+ * where the sequence number counts calls to pol_ready(); jobs with the default
+ * priority, no deadline and no rank are already in that order when appended,
+ * so they go into a circular FIFO, and only the others pay for a binary
+ * min-heap; the next job is the earlier of the two heads
+ */
+
+#include "policy.h"
+#include <stdlib.h>
+
+#define DEFAULT_POLICY_CAPACITY 64L
+
+typedef struct entry {
+    long prio;
+    unsigned long deadline;	/* 0 (none) is stored as the largest value */
+    long rank;
+    unsigned long seq;
+    void *job;
+} entry_t;
+
+struct policy {
+    long count;		/* in the heap */
+    long size;		/* of the heap and of the FIFO */
+    unsigned long seq;
+    entry_t *heap;
+    entry_t *fifo;
+    long fcount;
+    long fout;		/* index of the FIFO's head */
+};
+
+Policy *pol_create(long capacity) {
+    Policy *pol = (Policy *)malloc(sizeof(Policy));
+
+    if (pol != NULL) {
+        long cap = (capacity <= 0L) ? DEFAULT_POLICY_CAPACITY : capacity;
+
+        pol->heap = (entry_t *)malloc(cap * sizeof(entry_t));
+        pol->fifo = (entry_t *)malloc(cap * sizeof(entry_t));
+        if (pol->heap == NULL || pol->fifo == NULL) {
+            free(pol->heap);
+            free(pol->fifo);
+            free(pol);
+            return NULL;
+        }
+        pol->count = 0L;
+        pol->fcount = 0L;
+        pol->fout = 0L;
+        pol->size = cap;
+        pol->seq = 0UL;
+    }
+    return pol;
+}
+
+void pol_destroy(Policy *pol) {
+    free(pol->heap);
+    free(pol->fifo);
+    free(pol);
+}
+
+int pol_reserve(Policy *pol, long capacity) {
+    entry_t *heap, *fifo;
+    long i;
+
+    if (capacity <= pol->size)
+        return 1;
+    heap = (entry_t *)realloc(pol->heap, capacity * sizeof(entry_t));
+    if (heap == NULL)
+        return 0;
+    pol->heap = heap;
+    fifo = (entry_t *)malloc(capacity * sizeof(entry_t));
+    if (fifo == NULL)
+        return 0;
+    for (i = 0; i < pol->fcount; i++)	/* unwrap, head at index 0 */
+        fifo[i] = pol->fifo[(pol->fout + i) % pol->size];
+    free(pol->fifo);
+    pol->fifo = fifo;
+    pol->fout = 0L;
+    pol->size = capacity;
+    return 1;
+}
+
+static int before(entry_t *a, entry_t *b) {
+    if (a->prio != b->prio)
+        return a->prio < b->prio;
+    if (a->deadline != b->deadline)
+        return a->deadline < b->deadline;
+    if (a->rank != b->rank)
+        return a->rank > b->rank;
+    return a->seq < b->seq;
+}
+
+static void swap(entry_t *a, entry_t *b) {
+    entry_t tmp = *a;
+
+    *a = *b;
+    *b = tmp;
+}
+
+static void sift_up(Policy *pol, long i) {
+    while (i > 0 && before(&pol->heap[i], &pol->heap[(i - 1) / 2])) {
+        swap(&pol->heap[i], &pol->heap[(i - 1) / 2]);
+        i = (i - 1) / 2;
+    }
+}
+
+static void sift_down(Policy *pol, long i) {
+    for (;;) {
+        long l = 2 * i + 1, r = l + 1, m = i;
+
+        if (l < pol->count && before(&pol->heap[l], &pol->heap[m]))
+            m = l;
+        if (r < pol->count && before(&pol->heap[r], &pol->heap[m]))
+            m = r;
+        if (m == i)
+            return;
+        swap(&pol->heap[i], &pol->heap[m]);
+        i = m;
+    }
+}
+
+int pol_ready(Policy *pol, void *job, int prio, long deadline) {
+    return pol_ready_ranked(pol, job, prio, deadline, 0L);
+}
+
+int pol_ready_ranked(Policy *pol, void *job, int prio, long deadline, long rank) {
+    int plain = (prio == 0 && deadline == 0L && rank == 0L);
+    entry_t *e;
+
+    if ((plain ? pol->fcount : pol->count) == pol->size
+        && !pol_reserve(pol, 2 * pol->size))
+        return 0;
+    if (plain)
+        e = &pol->fifo[(pol->fout + pol->fcount) % pol->size];
+    else
+        e = &pol->heap[pol->count];
+    e->prio = prio;
+    e->deadline = (deadline == 0L) ? ~0UL : (unsigned long)deadline;
+    e->rank = rank;
+    e->seq = pol->seq++;
+    e->job = job;
+    if (plain)
+        pol->fcount++;
+    else
+        sift_up(pol, pol->count++);
+    return 1;
+}
+
+/*
+ * removes the entry at index `i', restoring the heap order
+ */
+static void remove_at(Policy *pol, long i) {
+    pol->heap[i] = pol->heap[--pol->count];
+    if (i < pol->count) {
+        sift_down(pol, i);
+        sift_up(pol, i);
+    }
+}
+
+int pol_next(Policy *pol, void **job) {
+    if (pol->fcount > 0L
+        && (pol->count == 0L || before(&pol->fifo[pol->fout], &pol->heap[0]))) {
+        *job = pol->fifo[pol->fout].job;
+        pol->fout = (pol->fout + 1) % pol->size;
+        pol->fcount--;
+        return 1;
+    }
+    if (pol->count <= 0L)
+        return 0;
+    *job = pol->heap[0].job;
+    remove_at(pol, 0);
+    return 1;
+}
+
+int pol_remove(Policy *pol, void *job) {
+    long i;
+
+    for (i = 0; i < pol->fcount; i++) {
+        if (pol->fifo[(pol->fout + i) % pol->size].job == job) {
+            for (; i + 1 < pol->fcount; i++)	/* close the gap */
+                pol->fifo[(pol->fout + i) % pol->size] =
+                    pol->fifo[(pol->fout + i + 1) % pol->size];
+            pol->fcount--;
+            return 1;
+        }
+    }
+    for (i = 0; i < pol->count; i++) {
+        if (pol->heap[i].job == job) {
+            remove_at(pol, i);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+long pol_size(Policy *pol) {
+    return pol->count + pol->fcount;
+}
@@ -0,0 +1,78 @@
+#ifndef _POLICY_H_
+#define _POLICY_H_
+
+/*
+ * interface definition for the ready-queue scheduling policy
+ *
+ * the dispatcher in uspsv3 and the discrete-event simulator both pick the
+ * next job through this interface, so a simulated run makes exactly the
+ * decisions a real run would make
+ *
+ * the policy is round robin within priority levels: the job picked next is
+ * the one with the lowest priority value, then the earliest deadline (jobs
+ * without one come last), then the highest rank (the length of the chain of
+ * jobs that depend on it, see dag.h), then the one that became ready first;
+ * when every job has the same priority, no deadline and rank 0 this is plain
+ * round robin
+ */
+
+typedef struct policy Policy;		/* opaque type definition */
+
+/*
+ * create a policy whose ready queue can hold `capacity' jobs without growing;
+ * if capacity is 0L, a default capacity is used
+ *
+ * returns a pointer to the policy, or NULL if there are malloc() errors
+ */
+Policy *pol_create(long capacity);
+
+/*
+ * destroys the policy; the jobs themselves belong to the caller
+ */
+void pol_destroy(Policy *pol);
+
+/*
+ * makes sure that `capacity' jobs fit in the ready queue without growing
+ *
+ * returns 1 if successful, 0 if unsuccessful (malloc failure)
+ */
+int pol_reserve(Policy *pol, long capacity);
+
+/*
+ * marks `job' ready to run with priority `prio' (lower runs first) and
+ * absolute deadline `deadline' (0L if none)
+ *
+ * the queue grows when it is full; growing calls malloc(), so callers in
+ * signal context must reserve enough room that it never has to
+ *
+ * returns 1 if successful, 0 if unsuccessful (malloc failure)
+ */
+int pol_ready(Policy *pol, void *job, int prio, long deadline);
+
+/*
+ * as pol_ready(), with rank `rank' (higher runs first, 0L for none)
+ */
+int pol_ready_ranked(Policy *pol, void *job, int prio, long deadline, long rank);
+
+/*
+ * picks the next job to run and removes it from the ready queue, returning
+ * it in `*job'
+ *
+ * returns 1 if successful, 0 if unsuccessful (no job is ready)
+ */
+int pol_next(Policy *pol, void **job);
+
+/*
+ * removes `job' from the ready queue; this is O(n), for control operations
+ * such as cancelling a job, not for the dispatch path
+ *
+ * returns 1 if the job was found, 0 if not
+ */
+int pol_remove(Policy *pol, void *job);
+
+/*
+ * returns the number of ready jobs
+ */
+long pol_size(Policy *pol);
+
+#endif /* _POLICY_H_ */
@@ -0,0 +1,169 @@
+/*
+ * implementation for the pressure-stall (PSI) governor
+ */
+
+#include "psi.h"
+#include "p1fxns.h"
+#include <fcntl.h>
+#include <unistd.h>
+
+typedef struct trigger {
+    int fd;
+    uint64_t window_ns;
+} trigger_t;
+
+static trigger_t triggers[PSI_MAX_TRIGGERS];
+static int ntriggers = 0;
+static uint64_t until = 0;		/* throttled before this time */
+static uint64_t since = 0;		/* start of the current episode */
+static uint64_t total_ns = 0;	/* of the episodes that have ended */
+static long episodes = 0;
+
+static char *resources[] = {"memory", "cpu", "io"};
+
+/*
+ * registers one trigger, "some <stall_us> <window_us>"
+ */
+static int add_trigger(char *resource, long stall_ms, long window_ms) {
+    char path[32], buf[64], num[25];
+    int fd;
+
+    if (ntriggers == PSI_MAX_TRIGGERS) {
+        p1putstr(2, "psi: too many triggers\n");
+        return 0;
+    }
+    p1strcpy(path, "/proc/pressure/");
+    p1strcat(path, resource);
+    fd = open(path, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (fd == -1) {
+        p1perror(2, path);
+        return 0;
+    }
+    p1strcpy(buf, "some ");
+    p1ltoa(stall_ms * 1000L, num);
+    p1strcat(buf, num);
+    p1strcat(buf, " ");
+    p1ltoa(window_ms * 1000L, num);
+    p1strcat(buf, num);
+    if (write(fd, buf, p1strlen(buf) + 1) == -1) {
+        p1perror(2, "psi: trigger rejected (is PSI enabled? see psi= on the kernel command line)");
+        close(fd);
+        return 0;
+    }
+    triggers[ntriggers].fd = fd;
+    triggers[ntriggers].window_ns = (uint64_t)window_ms * 1000000ULL;
+    ntriggers++;
+    return 1;
+}
+
+int psi_open(char *spec) {
+    char *p = spec;
+
+    while (*p != '\0') {
+        int colon = p1strchr(p, ':');
+        long stall, window = 1000L;
+        unsigned r;
+
+        for (r = 0; r < sizeof(resources) / sizeof(resources[0]); r++)
+            if (colon == p1strlen(resources[r]) && p1strneq(p, resources[r], colon))
+                break;
+        if (colon == -1 || r == sizeof(resources) / sizeof(resources[0])
+            || p[colon + 1] < '0' || p[colon + 1] > '9') {
+            p1putstr(2, "psi: expected <memory|cpu|io>:<stall_ms>[/<window_ms>]\n");
+            psi_close();
+            return 0;
+        }
+        p += colon + 1;
+        stall = p1atoi(p);
+        while (*p >= '0' && *p <= '9')
+            p++;
+        if (*p == '/') {
+            window = p1atoi(++p);
+            while (*p >= '0' && *p <= '9')
+                p++;
+        }
+        if (!add_trigger(resources[r], stall, window)) {
+            psi_close();
+            return 0;
+        }
+        if (*p == ',')
+            p++;
+        else if (*p != '\0') {
+            p1putstr(2, "psi: expected , between triggers\n");
+            psi_close();
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int psi_fds(int fds[PSI_MAX_TRIGGERS]) {
+    int i;
+
+    for (i = 0; i < ntriggers; i++)
+        fds[i] = triggers[i].fd;
+    return ntriggers;
+}
+
+int psi_event(int fd, uint64_t now) {
+    int was = psi_throttled(now);
+    int i;
+
+    for (i = 0; i < ntriggers && triggers[i].fd != fd; i++)
+        ;
+    if (i == ntriggers)
+        return 0;
+    if (now + triggers[i].window_ns > until)
+        until = now + triggers[i].window_ns;
+    if (!was) {
+        since = now;
+        episodes++;
+    }
+    return !was;
+}
+
+int psi_throttled(uint64_t now) {
+    if (since != 0 && now >= until) {	/* the episode ended at `until' */
+        total_ns += until - since;
+        since = 0;
+    }
+    return since != 0;
+}
+
+uint64_t psi_throttled_ns(uint64_t now, long *n) {
+    if (n != NULL)
+        *n = episodes;
+    if (psi_throttled(now))
+        return total_ns + (now - since);
+    return total_ns;
+}
+
+long psi_rss_kb(pid_t pid) {
+    char path[40], buf[128], num[25];
+    long pages;
+    int fd, n, i = 0;
+
+    p1strcpy(path, "/proc/");
+    p1ltoa((long)pid, num);
+    p1strcat(path, num);
+    p1strcat(path, "/statm");
+    if ((fd = open(path, O_RDONLY | O_CLOEXEC)) == -1)
+        return 0L;
+    n = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (n <= 0)
+        return 0L;
+    buf[n] = '\0';
+    while (buf[i] != ' ' && buf[i] != '\0')	/* size, then resident */
+        i++;
+    pages = p1atoi(buf + i + (buf[i] == ' '));
+    return pages * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+void psi_close(void) {
+    int i;
+
+    for (i = 0; i < ntriggers; i++)
+        close(triggers[i].fd);
+    ntriggers = 0;
+}
@@ -0,0 +1,69 @@
+#ifndef _PSI_H_
+#define _PSI_H_
+
+/*
+ * interface definition for the pressure-stall (PSI) governor
+ *
+ * the governor registers PSI triggers on /proc/pressure/{memory,cpu,io}:
+ * the kernel wakes a poll() on a trigger's descriptor (POLLPRI) when tasks
+ * have stalled on the resource for more than the threshold within the
+ * window, and does so at most once per window while the pressure lasts;
+ * nothing is read periodically
+ *
+ * the governor is throttled from the first event until a whole window of
+ * the trigger passes without another one; the scheduler does not admit new
+ * jobs while it is throttled, and keeps the heaviest ones off the CPU
+ */
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#define PSI_MAX_TRIGGERS 3	/* one per resource */
+
+/*
+ * parses `spec', a comma-separated list of <resource>:<stall_ms>[/<window_ms>]
+ * where resource is memory, cpu or io (e.g. "memory:100/1000,io:200"; the
+ * window defaults to 1000 ms), and registers a trigger for each item
+ *
+ * returns 1 if successful, 0 if not (the reason has been written to
+ * standard error)
+ */
+int psi_open(char *spec);
+
+/*
+ * returns the number of triggers, and in fds[] their descriptors, to be
+ * polled for POLLPRI
+ */
+int psi_fds(int fds[PSI_MAX_TRIGGERS]);
+
+/*
+ * records an event on trigger descriptor `fd' at `now' (monotonic ns)
+ *
+ * returns 1 if the governor became throttled, 0 if it already was
+ */
+int psi_event(int fd, uint64_t now);
+
+/*
+ * returns 1 if the governor is throttled at `now', 0 if not; an episode
+ * ends when its window has passed without an event
+ */
+int psi_throttled(uint64_t now);
+
+/*
+ * returns the total time spent throttled up to `now', and in `*episodes'
+ * (if not NULL) the number of throttled episodes
+ */
+uint64_t psi_throttled_ns(uint64_t now, long *episodes);
+
+/*
+ * returns the resident set size of process `pid' in KB, 0 if unknown;
+ * how the governor ranks jobs by weight
+ */
+long psi_rss_kb(pid_t pid);
+
+/*
+ * closes the triggers
+ */
+void psi_close(void);
+
+#endif /* _PSI_H_ */
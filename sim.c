@@ -0,0 +1,435 @@
+/*
+ * implementation for the discrete-event simulator
+ *
+ * all times are kept in microseconds of virtual time
+ */
+
+#include "sim.h"
+#include "policy.h"
+#include "stats.h"
+#include "tracer.h"
+#include "p1fxns.h"
+#include <stdlib.h>
+#include <unistd.h>
+
+#define READ_SIZE 65536
+#define SIM_LINE_SIZE 4096
+#define SIM_MAX_MSEC 1000000000000L	/* about 31 years; a job's totals stay well within a long */
+
+typedef struct simjob simjob_t;
+
+struct simjob {
+    long arrival;	/* when the job enters the ready queue */
+    long first;		/* first dispatch, -1 until dispatched */
+    long remaining;	/* CPU time left in the current burst */
+    long cpu;		/* total CPU demand */
+    long io;		/* total I/O time */
+    long bursts;	/* offset of the first burst in the burst pool */
+    int nbursts;	/* CPU, I/O, CPU, ... always odd */
+    int burst;		/* index of the current burst */
+    long seq;		/* line order, breaks ties between equal arrivals */
+};
+
+/*
+ * the trace as loaded: a job table plus one pool holding every burst
+ */
+typedef struct trace {
+    simjob_t *jobs;
+    long njobs;
+    long jobcap;
+    long *pool;
+    long npool;
+    long poolcap;
+} trace_t;
+
+/*
+ * pending I/O completions, a binary min-heap on completion time
+ */
+typedef struct ioevent {
+    long when;
+    long seq;		/* insertion order, keeps the heap deterministic */
+    simjob_t *job;
+} ioevent_t;
+
+typedef struct ioheap {
+    ioevent_t *ev;
+    long count;
+    long size;
+    long seq;
+} ioheap_t;
+
+/*
+ * buffered line reader; p1getline() issues one read() per character,
+ * which dominates the run time for traces with millions of lines
+ */
+typedef struct reader {
+    int fd;
+    char buf[READ_SIZE];
+    int len;
+    int pos;
+} reader_t;
+
+static int getline_buffered(reader_t *r, char line[], int size) {
+    int i = 0;
+
+    while (i < size - 1) {
+        if (r->pos == r->len) {
+            r->len = read(r->fd, r->buf, READ_SIZE);
+            r->pos = 0;
+            if (r->len <= 0) {
+                r->len = 0;
+                break;
+            }
+        }
+        line[i] = r->buf[r->pos++];
+        if (line[i++] == '\n')
+            break;
+    }
+    line[i] = '\0';
+    return i;
+}
+
+static void parse_error(long lineno, char *msg) {
+    p1bputstr(2, "trace line ");
+    p1bputlong(2, lineno);
+    p1bputstr(2, ": ");
+    p1bputstr(2, msg);
+    p1bputstr(2, "\n");
+    p1bflush(2);
+}
+
+/*
+ * converts the digits of `word' to usec; returns 0 if it is not a number
+ * of msec or is larger than SIM_MAX_MSEC
+ */
+static int parse_msec(char *word, long *usec) {
+    long msec = 0L;
+    int i;
+
+    for (i = 0; word[i] >= '0' && word[i] <= '9'; i++) {
+        msec = 10 * msec + (word[i] - '0');
+        if (msec > SIM_MAX_MSEC)
+            return 0;
+    }
+    if (i == 0 || word[i] != '\0')
+        return 0;
+    *usec = 1000L * msec;
+    return 1;
+}
+
+static int push_burst(trace_t *t, long usec) {
+    if (t->npool == t->poolcap) {
+        long cap = (t->poolcap == 0L) ? 1024L : 2 * t->poolcap;
+        long *tmp = (long *)realloc(t->pool, cap * sizeof(long));
+
+        if (tmp == NULL)
+            return 0;
+        t->pool = tmp;
+        t->poolcap = cap;
+    }
+    t->pool[t->npool++] = usec;
+    return 1;
+}
+
+static simjob_t *new_job(trace_t *t) {
+    if (t->njobs == t->jobcap) {
+        long cap = (t->jobcap == 0L) ? 1024L : 2 * t->jobcap;
+        simjob_t *tmp = (simjob_t *)realloc(t->jobs, cap * sizeof(simjob_t));
+
+        if (tmp == NULL)
+            return NULL;
+        t->jobs = tmp;
+        t->jobcap = cap;
+    }
+    return &t->jobs[t->njobs++];
+}
+
+/*
+ * parses one trace line into a job; returns 1 if a job was added, 0 if the
+ * line is blank or a comment, -1 on error
+ */
+static int parse_line(trace_t *t, char *line, long lineno) {
+    char word[SIM_LINE_SIZE];
+    simjob_t *job;
+    int i = 0;
+    int n = 0;
+
+    while (line[i] == ' ' || line[i] == '\t')
+        i++;
+    if (line[i] == '\0' || line[i] == '\n' || line[i] == '#')
+        return 0;
+    if ((job = new_job(t)) == NULL) {
+        p1putstr(2, "Failed to allocate job table\n");
+        return -1;
+    }
+    job->bursts = t->npool;
+    job->cpu = job->io = 0L;
+    job->first = -1L;
+    job->seq = t->njobs - 1;
+    while ((i = p1getword(line, i, word)) != -1) {
+        long usec;
+
+        if (!parse_msec(word, &usec)) {
+            parse_error(lineno, "expected a number of msec from 0 to 1000000000000");
+            return -1;
+        }
+        if (n == 0) {
+            job->arrival = usec;
+        } else {
+            if (!push_burst(t, usec)) {
+                p1putstr(2, "Failed to allocate burst pool\n");
+                return -1;
+            }
+            if (n % 2)
+                job->cpu += usec;
+            else
+                job->io += usec;
+        }
+        n++;
+    }
+    if (n < 2 || n % 2 != 0) {
+        parse_error(lineno, "expected <arrival> <cpu> [<io> <cpu>]...");
+        return -1;
+    }
+    job->nbursts = n - 1;
+    return 1;
+}
+
+static int load_trace(int fd, trace_t *t) {
+    static reader_t r;
+    char line[SIM_LINE_SIZE];
+    long lineno = 0;
+    int len;
+
+    r.fd = fd;
+    r.len = r.pos = 0;
+    while ((len = getline_buffered(&r, line, SIM_LINE_SIZE)) > 0) {
+        lineno++;
+        if (line[len - 1] == '\n')
+            line[len - 1] = '\0';
+        if (parse_line(t, line, lineno) < 0)
+            return 0;
+    }
+    return 1;
+}
+
+static int by_arrival(const void *a, const void *b) {
+    const simjob_t *x = (const simjob_t *)a;
+    const simjob_t *y = (const simjob_t *)b;
+
+    if (x->arrival != y->arrival)
+        return (x->arrival < y->arrival) ? -1 : 1;
+    return (x->seq < y->seq) ? -1 : (x->seq > y->seq);
+}
+
+static int io_before(ioevent_t *a, ioevent_t *b) {
+    return a->when < b->when || (a->when == b->when && a->seq < b->seq);
+}
+
+static int io_push(ioheap_t *h, long when, simjob_t *job) {
+    long i;
+
+    if (h->count == h->size) {
+        long cap = (h->size == 0L) ? 1024L : 2 * h->size;
+        ioevent_t *tmp = (ioevent_t *)realloc(h->ev, cap * sizeof(ioevent_t));
+
+        if (tmp == NULL)
+            return 0;
+        h->ev = tmp;
+        h->size = cap;
+    }
+    i = h->count++;
+    h->ev[i].when = when;
+    h->ev[i].seq = h->seq++;
+    h->ev[i].job = job;
+    while (i > 0 && io_before(&h->ev[i], &h->ev[(i - 1) / 2])) {
+        ioevent_t tmp = h->ev[i];
+
+        h->ev[i] = h->ev[(i - 1) / 2];
+        h->ev[(i - 1) / 2] = tmp;
+        i = (i - 1) / 2;
+    }
+    return 1;
+}
+
+static simjob_t *io_pop(ioheap_t *h) {
+    simjob_t *job = h->ev[0].job;
+    long i = 0;
+
+    h->ev[0] = h->ev[--h->count];
+    for (;;) {
+        long l = 2 * i + 1, r = l + 1, m = i;
+        ioevent_t tmp;
+
+        if (l < h->count && io_before(&h->ev[l], &h->ev[m]))
+            m = l;
+        if (r < h->count && io_before(&h->ev[r], &h->ev[m]))
+            m = r;
+        if (m == i)
+            break;
+        tmp = h->ev[i];
+        h->ev[i] = h->ev[m];
+        h->ev[m] = tmp;
+        i = m;
+    }
+    return job;
+}
+
+/*
+ * the simulation state, shared by the helpers below
+ */
+typedef struct sim {
+    trace_t t;
+    Policy *ready;
+    ioheap_t io;
+    long next;		/* next job in t.jobs to arrive */
+    long now;
+} sim_t;
+
+/*
+ * moves every job that arrives or finishes I/O by `now' onto the ready
+ * queue, in the order in which those events happen
+ */
+static int admit(sim_t *s) {
+    for (;;) {
+        simjob_t *job;
+        long ta = (s->next < s->t.njobs) ? s->t.jobs[s->next].arrival : -1;
+        long ti = (s->io.count > 0) ? s->io.ev[0].when : -1;
+
+        if (ta >= 0 && ta <= s->now && (ti < 0 || ti > s->now || ta <= ti)) {
+            job = &s->t.jobs[s->next++];
+            job->burst = 0;
+            job->remaining = s->t.pool[job->bursts];
+        } else if (ti >= 0 && ti <= s->now) {
+            job = io_pop(&s->io);
+            job->burst++;
+            job->remaining = s->t.pool[job->bursts + job->burst];
+        } else
+            return 1;
+        tr_record_at(1000ULL * s->now, (job->burst == 0) ? TR_SPAWN : TR_WAKE,
+                     job->seq, 0, 0, 0);
+        if (tr_pending() > DEFAULT_TRACE_EVENTS / 2)
+            tr_flush();
+        if (!pol_ready(s->ready, job, 0, 0L))
+            return 0;
+    }
+}
+
+/*
+ * the earliest future arrival or I/O completion, -1 if there is none
+ */
+static long next_event(sim_t *s) {
+    long ta = (s->next < s->t.njobs) ? s->t.jobs[s->next].arrival : -1;
+    long ti = (s->io.count > 0) ? s->io.ev[0].when : -1;
+
+    if (ta < 0)
+        return ti;
+    if (ti < 0 || ta < ti)
+        return ta;
+    return ti;
+}
+
+int sim_run(int fd, int quantum) {
+    sim_t s;
+    Series turnaround, response, waiting, share;
+    long finished = 0, dispatches = 0, switches = 0, busy = 0, start;
+    long slice = 1000L * quantum;
+    int ok = 0;
+
+    s.t.jobs = NULL;
+    s.t.pool = NULL;
+    s.t.njobs = s.t.jobcap = s.t.npool = s.t.poolcap = 0L;
+    s.io.ev = NULL;
+    s.io.count = s.io.size = s.io.seq = 0L;
+    s.next = 0L;
+    s.ready = NULL;
+    st_init(&turnaround, "turnaround");
+    st_init(&response, "response");
+    st_init(&waiting, "waiting");
+    st_init(&share, "cpu_share");	/* CPU received per unit of turnaround, in ppm */
+
+    if (!load_trace(fd, &s.t))
+        goto out;
+    if (s.t.njobs == 0) {
+        p1putstr(2, "trace contains no jobs\n");
+        goto out;
+    }
+    qsort(s.t.jobs, s.t.njobs, sizeof(simjob_t), by_arrival);
+    if ((s.ready = pol_create(s.t.njobs)) == NULL) {
+        p1putstr(2, "Failed to create ready queue\n");
+        goto out;
+    }
+    s.now = start = s.t.jobs[0].arrival;
+
+    while (finished < s.t.njobs) {
+        simjob_t *job;
+        long run;
+
+        if (!admit(&s))
+            goto nomem;
+        if (!pol_next(s.ready, (void **)&job)) {
+            s.now = next_event(&s);	/* idle until something happens */
+            continue;
+        }
+        dispatches++;
+        if (job->first < 0)
+            job->first = s.now;
+        tr_record_at(1000ULL * s.now, TR_DISPATCH, job->seq, 0, 0, 0);
+        run = (job->remaining < slice) ? job->remaining : slice;
+        s.now += run;
+        busy += run;
+        job->remaining -= run;
+        if (!admit(&s))		/* arrivals during the slice go first */
+            goto nomem;
+        if (tr_pending() > DEFAULT_TRACE_EVENTS / 2)
+            tr_flush();
+        if (job->remaining > 0) {
+            switches++;
+            tr_record_at(1000ULL * s.now, TR_PREEMPT, job->seq, 0, 0, 0);
+            if (!pol_ready(s.ready, job, 0, 0L))
+                goto nomem;
+        } else if (job->burst + 1 < job->nbursts) {
+            job->burst++;	/* now in I/O */
+            tr_record_at(1000ULL * s.now, TR_BLOCK, job->seq, 0, 0, 0);
+            if (!io_push(&s.io, s.now + s.t.pool[job->bursts + job->burst], job))
+                goto nomem;
+        } else {
+            long ta = s.now - job->arrival;
+
+            finished++;
+            tr_record_at(1000ULL * s.now, TR_EXIT, job->seq, 0, 0, 0);
+            if (!st_add(&turnaround, ta) || !st_add(&response, job->first - job->arrival)
+                || !st_add(&waiting, ta - job->cpu - job->io)
+                || !st_add(&share, (ta > 0) ? (long)(1000000.0 * job->cpu / ta) : 1000000L))
+                goto nomem;
+        }
+    }
+
+    st_putcount(1, "jobs", s.t.njobs);
+    st_putcount(1, "quantum_ms", quantum);
+    st_putms(1, "makespan_ms", s.now - start);
+    st_print(1, &turnaround);
+    st_print(1, &response);
+    st_print(1, &waiting);
+    st_putjain(1, "jain_fairness", &share);
+    st_putcount(1, "dispatches", dispatches);
+    st_putcount(1, "context_switches", switches);
+    st_putpct(1, "cpu_utilization", busy, s.now - start);
+    p1bflush(1);
+    ok = 1;
+    goto out;
+
+nomem:
+    p1putstr(2, "simulation ran out of memory\n");
+out:
+    if (s.ready != NULL)
+        pol_destroy(s.ready);
+    free(s.io.ev);
+    free(s.t.jobs);
+    free(s.t.pool);
+    st_free(&turnaround);
+    st_free(&response);
+    st_free(&waiting);
+    st_free(&share);
+    return ok;
+}
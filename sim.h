@@ -0,0 +1,27 @@
+#ifndef _SIM_H_
+#define _SIM_H_
+
+/*
+ * interface definition for the discrete-event simulator
+ *
+ * instead of forking the workload, the simulator replays a trace through
+ * the same ready-queue policy as the real dispatcher, advancing a virtual
+ * clock; no processes are created and no signals are sent
+ *
+ * each non-blank line of the trace describes one job:
+ *
+ *	<arrival_ms> <cpu_ms> [<io_ms> <cpu_ms>]...
+ *
+ * i.e. the arrival time followed by alternating CPU and I/O bursts, always
+ * starting and ending with a CPU burst; lines starting with '#' are ignored
+ */
+
+/*
+ * runs the trace read from `fd' with a time slice of `quantum' msec and
+ * writes the resulting statistics on file descriptor 1
+ *
+ * returns 1 if successful, 0 otherwise (an error has been reported on fd 2)
+ */
+int sim_run(int fd, int quantum);
+
+#endif /* _SIM_H_ */
@@ -0,0 +1,175 @@
+/*
+ * implementation for soft scheduling
+ *
+ * whether priorities can be raised again is found out once, by lowering
+ * the scheduler's own nice value by one and restoring it
+ */
+
+#define _GNU_SOURCE	/* SCHED_BATCH, SCHED_IDLE */
+#include "soft.h"
+#include "usps.h"
+#include "p1fxns.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+/*
+ * the first version of struct sched_attr, for sched_setattr(), which the
+ * C library may not wrap
+ */
+typedef struct sf_attr {
+    uint32_t size;
+    uint32_t policy;
+    uint64_t flags;
+    int32_t nice;
+    uint32_t priority;
+    uint64_t runtime;
+    uint64_t deadline;
+    uint64_t period;
+} sf_attr_t;
+
+static int base;	/* the scheduler's nice value */
+static int can_raise;	/* demoted jobs can be given their share back */
+static char *root;	/* USPS_CGROUP: the parent of the jobs' groups */
+
+/*
+ * writes `s' to file `path'
+ */
+static int put(char *path, char *s) {
+    int fd = open(path, O_WRONLY | O_CLOEXEC), ok;
+
+    if (fd == -1)
+        return 0;
+    ok = (write(fd, s, p1strlen(s)) == p1strlen(s));
+    close(fd);
+    return ok;
+}
+
+/*
+ * checks that USPS_CGROUP names a cgroup v2 directory that offers the cpu
+ * controller, and enables it for the jobs' groups
+ */
+static int open_root(void) {
+    char path[PATH_MAX], line[1024], word[1024];
+    int fd, i = 0, cpu = 0;
+
+    if ((root = getenv("USPS_CGROUP")) == NULL || p1strlen(root) > PATH_MAX - 64)
+        return 0;
+    p1strcpy(path, root);
+    p1strcat(path, "/cgroup.controllers");
+    if ((fd = open(path, O_RDONLY | O_CLOEXEC)) == -1)
+        return 0;
+    if (p1getline(fd, line, sizeof(line)) > 0)
+        while (!cpu && (i = p1getword(line, i, word)) != -1)
+            cpu = p1strneq(word, "cpu", 4);
+    close(fd);
+    p1strcpy(path, root);
+    p1strcat(path, "/cgroup.subtree_control");
+    return cpu && put(path, "+cpu");
+}
+
+int sf_open(int backend) {
+    errno = 0;
+    base = getpriority(PRIO_PROCESS, 0);
+    if (errno != 0)
+        base = 0;
+    if ((can_raise = (setpriority(PRIO_PROCESS, 0, base - 1) == 0)))
+        setpriority(PRIO_PROCESS, 0, base);
+    if (backend == USPS_CGROUP && !open_root()) {
+        p1putstr(2, "usps: USPS_CGROUP is not a writable cgroup v2 directory with the cpu controller, using nice\n");
+        backend = USPS_NICE;
+    }
+    if (backend != USPS_CGROUP && !can_raise)
+        p1putstr(2, "usps: without CAP_SYS_NICE, jobs keep the share of their priority\n");
+    return backend;
+}
+
+/*
+ * the nice value of a job with priority `prio', with a slot or without
+ */
+static int nice_of(sf_job_t *job, int prio, int slot) {
+    int nice = base + ((prio > 0) ? prio : 0);
+
+    if (!slot && (can_raise || job->backend == USPS_CGROUP))
+        return 19;
+    return (nice < 19) ? nice : 19;
+}
+
+void sf_join(sf_job_t *job, int backend, pid_t pid, long id, int prio) {
+    char path[PATH_MAX], buf[25];
+
+    job->backend = backend;
+    job->pid = pid;
+    job->weight = -1;
+    job->group = NULL;
+    if (backend == USPS_CGROUP) {
+        p1strcpy(path, root);
+        p1strcat(path, "/usps-");
+        p1ltoa((long)getpid(), buf);
+        p1strcat(path, buf);
+        p1strcat(path, "-");
+        p1ltoa(id, buf);
+        p1strcat(path, buf);
+        if ((mkdir(path, 0755) == -1 && errno != EEXIST) || (job->group = p1strdup(path)) == NULL) {
+            p1perror(2, path);
+            job->backend = USPS_NICE;
+        } else {
+            p1strcat(path, "/cgroup.procs");
+            p1ltoa((long)pid, buf);
+            if (!put(path, buf)) {
+                p1perror(2, path);
+                job->backend = USPS_NICE;
+            } else {
+                p1strcpy(path, job->group);
+                p1strcat(path, "/cpu.weight.nice");
+                if ((job->weight = open(path, O_WRONLY | O_CLOEXEC)) == -1) {
+                    p1perror(2, path);
+                    job->backend = USPS_NICE;
+                }
+            }
+        }
+    }
+    sf_share(job, prio, 0);
+}
+
+void sf_share(sf_job_t *job, int prio, int slot) {
+    int nice = nice_of(job, prio, slot);
+    char buf[25];
+
+    switch (job->backend) {
+    case USPS_NICE:
+        (void)setpriority(PRIO_PROCESS, job->pid, nice);
+        break;
+    case USPS_IDLE: {
+        sf_attr_t attr = {0};
+
+        attr.size = sizeof(attr);
+        attr.policy = (slot || !can_raise) ? SCHED_BATCH : SCHED_IDLE;
+        attr.nice = nice;
+        (void)syscall(SYS_sched_setattr, job->pid, &attr, 0);
+        break;
+    }
+    case USPS_CGROUP:
+        p1itoa(nice, buf);
+        (void)pwrite(job->weight, buf, p1strlen(buf), 0);
+        break;
+    }
+}
+
+void sf_leave(sf_job_t *job) {
+    if (job->weight != -1)
+        close(job->weight);
+    job->weight = -1;
+    if (job->group != NULL) {
+        rmdir(job->group);
+        free(job->group);
+        job->group = NULL;
+    }
+}
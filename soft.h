@@ -0,0 +1,69 @@
+#ifndef _SOFT_H_
+#define _SOFT_H_
+
+/*
+ * interface definition for soft scheduling, part of libusps
+ *
+ * a soft backend runs every job at once and leaves the switching to the
+ * kernel: a job that holds a slot gets its full share, one that waits for
+ * a slot is demoted rather than stopped, so it still uses whatever CPU the
+ * others leave idle
+ *
+ *	USPS_NICE    a job with a slot runs at nice (base + its priority),
+ *	             base being the scheduler's own nice; one without runs
+ *	             at nice 19
+ *	USPS_IDLE    a job with a slot runs SCHED_BATCH at the same nice, one
+ *	             without runs SCHED_IDLE; set with sched_setattr()
+ *	USPS_CGROUP  each job has a cgroup v2 group of its own under the
+ *	             directory named by USPS_CGROUP, and the nice values above
+ *	             go to its cpu.weight.nice, which covers the job's own
+ *	             children too
+ *
+ * giving a job its slot back lowers its nice value (or leaves SCHED_IDLE),
+ * which needs CAP_SYS_NICE; without it, USPS_NICE and USPS_IDLE set each
+ * job's share once from its priority and never demote it. USPS_CGROUP
+ * needs only write access to the directory, and falls back to USPS_NICE
+ * when it cannot be used
+ *
+ * nice values and scheduling policies are per thread: USPS_NICE and
+ * USPS_IDLE set them on the job's main thread, and the threads and
+ * children it creates inherit them when they are created; a cgroup holds
+ * all of them
+ */
+
+#include <sys/types.h>
+
+typedef struct sf_job {
+    int backend;	/* USPS_NICE ... USPS_CGROUP */
+    pid_t pid;
+    int weight;		/* USPS_CGROUP: cpu.weight.nice, or -1 */
+    char *group;	/* USPS_CGROUP: the job's directory, or NULL */
+} sf_job_t;
+
+/*
+ * sets up `backend' for this process; call it before any sf_join()
+ *
+ * returns the backend to use, which is USPS_NICE if USPS_CGROUP is not
+ * available (the reason has been written to standard error)
+ */
+int sf_open(int backend);
+
+/*
+ * puts job `id', process `pid' under `backend' (as returned by sf_open()),
+ * demoted until it is given a slot; call it before the job is started, so
+ * that its command starts with its share; a job that cannot be given a
+ * cgroup is reniced instead (the reason has been written to standard error)
+ */
+void sf_join(sf_job_t *job, int backend, pid_t pid, long id, int prio);
+
+/*
+ * gives the job its full share (`slot' 1) or demotes it (`slot' 0)
+ */
+void sf_share(sf_job_t *job, int prio, int slot);
+
+/*
+ * removes the job's cgroup, once it has been reaped
+ */
+void sf_leave(sf_job_t *job);
+
+#endif /* _SOFT_H_ */
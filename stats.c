@@ -0,0 +1,147 @@
+/*
+ * implementation for run statistics
+ */
+
+#include "stats.h"
+#include "p1fxns.h"
+#include <stdlib.h>
+
+void st_init(Series *s, char *name) {
+    s->name = name;
+    s->count = 0L;
+    s->sum = 0L;
+    s->max = 0L;
+    s->values = NULL;
+    s->cap = 0L;
+}
+
+void st_free(Series *s) {
+    free(s->values);
+    s->values = NULL;
+    s->cap = 0L;
+}
+
+int st_add(Series *s, long usec) {
+    if (s->count == s->cap) {
+        long cap = (s->cap == 0) ? 1024 : 2 * s->cap;
+        long *values = (long *)realloc(s->values, cap * sizeof(long));
+
+        if (values == NULL)
+            return 0;
+        s->values = values;
+        s->cap = cap;
+    }
+    s->values[s->count++] = usec;
+    s->sum += usec;
+    if (usec > s->max)
+        s->max = usec;
+    return 1;
+}
+
+static int by_value(const void *a, const void *b) {
+    long x = *(const long *)a, y = *(const long *)b;
+
+    return (x > y) - (x < y);
+}
+
+static long percentile(Series *s, int pct) {
+    long rank = (s->count * pct + 99) / 100;
+
+    return (s->count > 0) ? s->values[(rank > 0) ? rank - 1 : 0] : 0L;
+}
+
+/*
+ * formats `usec' as milliseconds with three decimals, e.g. "12.034"
+ */
+static void fmt_ms(long usec, char *buf) {
+    char frac[8];
+    char *p;
+
+    if (usec < 0) {
+        *buf++ = '-';
+        usec = -usec;
+    }
+    p1ltoa(usec / 1000, buf);
+    p = buf + p1strlen(buf);
+    *p++ = '.';
+    p1ltoa(usec % 1000, frac);
+    p1strpack(frac, -3, '0', p);
+}
+
+static void putfield(int fd, char *label, char *value) {
+    p1bputstr(fd, label);
+    p1bputstr(fd, " ");
+    p1bputstr(fd, value);
+}
+
+void st_print(int fd, Series *s) {
+    static int pcts[] = {50, 90, 99};
+    char buf[32], label[8];
+    int i;
+
+    qsort(s->values, s->count, sizeof(long), by_value);
+    p1bputstr(fd, s->name);
+    fmt_ms((s->count > 0) ? s->sum / s->count : 0L, buf);
+    putfield(fd, "_ms mean", buf);
+    for (i = 0; i < 3; i++) {
+        p1strcpy(label, " p");
+        p1ltoa(pcts[i], label + 2);
+        fmt_ms(percentile(s, pcts[i]), buf);
+        putfield(fd, label, buf);
+    }
+    fmt_ms(s->max, buf);
+    putfield(fd, " max", buf);
+    p1bputstr(fd, "\n");
+}
+
+void st_putcount(int fd, char *label, long value) {
+    char buf[32];
+
+    p1ltoa(value, buf);
+    putfield(fd, label, buf);
+    p1bputstr(fd, "\n");
+}
+
+void st_putms(int fd, char *label, long usec) {
+    char buf[32];
+
+    fmt_ms(usec, buf);
+    putfield(fd, label, buf);
+    p1bputstr(fd, "\n");
+}
+
+void st_putpct(int fd, char *label, long part, long whole) {
+    char buf[32];
+    long tenths = (whole > 0) ? (1000 * part) / whole : 0L;
+    char *p;
+
+    p1ltoa(tenths / 10, buf);
+    p = buf + p1strlen(buf);
+    *p++ = '.';
+    *p++ = '0' + tenths % 10;
+    *p++ = '%';
+    *p = '\0';
+    putfield(fd, label, buf);
+    p1bputstr(fd, "\n");
+}
+
+void st_putjain(int fd, char *label, Series *s) {
+    char buf[32], frac[8];
+    double sum = 0.0, squares = 0.0;
+    long i, tenk = 10000L;
+    char *p;
+
+    for (i = 0; i < s->count; i++) {
+        sum += (double)s->values[i];
+        squares += (double)s->values[i] * (double)s->values[i];
+    }
+    if (squares > 0.0)
+        tenk = (long)(10000.0 * sum * sum / ((double)s->count * squares) + 0.5);
+    p1ltoa(tenk / 10000, buf);
+    p = buf + p1strlen(buf);
+    *p++ = '.';
+    p1ltoa(tenk % 10000, frac);
+    p1strpack(frac, -4, '0', p);
+    putfield(fd, label, buf);
+    p1bputstr(fd, "\n");
+}
@@ -0,0 +1,69 @@
+#ifndef _STATS_H_
+#define _STATS_H_
+
+/*
+ * interface definition for run statistics
+ *
+ * a Series accumulates one value per job (e.g. turnaround time, in usec);
+ * both real and simulated runs report through these functions so that
+ * their numbers can be compared line for line
+ *
+ * the values are kept, so that percentiles are exact
+ */
+
+typedef struct series {
+    char *name;		/* printed as "<name>_ms" */
+    long count;
+    long sum;
+    long max;
+    long *values;	/* count of them, sorted by st_print() */
+    long cap;
+} Series;
+
+/*
+ * initializes an empty series called `name'
+ */
+void st_init(Series *s, char *name);
+
+/*
+ * frees the samples of the series
+ */
+void st_free(Series *s);
+
+/*
+ * adds one sample (in usec) to the series
+ *
+ * returns 1 if successful, 0 if there are malloc() errors
+ */
+int st_add(Series *s, long usec);
+
+/*
+ * writes "<name>_ms mean <m> p50 <m> p90 <m> p99 <m> max <m>" on `fd';
+ * a percentile is the smallest sample at least that many percent of the
+ * samples are no larger than
+ */
+void st_print(int fd, Series *s);
+
+/*
+ * writes "<label> <j>" on `fd', where j is Jain's fairness index of the
+ * samples, (sum x)^2 / (n * sum x^2), with four decimals: 1 if they are
+ * all equal, down to 1/n if one sample has it all
+ */
+void st_putjain(int fd, char *label, Series *s);
+
+/*
+ * writes "<label> <value>" on `fd', for integral counters
+ */
+void st_putcount(int fd, char *label, long value);
+
+/*
+ * writes "<label> <value>" on `fd', `usec' shown in milliseconds
+ */
+void st_putms(int fd, char *label, long usec);
+
+/*
+ * writes "<label> <part/whole as a percentage>" on `fd'
+ */
+void st_putpct(int fd, char *label, long part, long whole);
+
+#endif /* _STATS_H_ */
@@ -0,0 +1,322 @@
+/*
+ * implementation for in-process tasks
+ *
+ * the scheduler runs on the caller's stack; each turn switches to the task
+ * and back, so tasks never switch to one another directly
+ */
+
+#include "task.h"
+#include "policy.h"
+#include "p1fxns.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#if !defined(__x86_64__) || defined(TK_UCONTEXT)
+#define TK_USE_UCONTEXT
+#include <ucontext.h>
+#else
+#define TK_FP_CONTROL 0x0000037f00001f80UL	/* x87 control word 0x37f over MXCSR 0x1f80, as tk_switch() stores them */
+#endif
+
+typedef struct task {
+    long id;
+    int state;		/* USPS_READY ... USPS_DONE */
+    int prio;
+    void (*fn)(void *arg);
+    void *arg;
+    char *stack;	/* the mapping, guard page first; NULL when it has none */
+#ifdef TK_USE_UCONTEXT
+    ucontext_t ctx;
+#else
+    void *sp;		/* saved stack pointer while switched out */
+#endif
+} task_t;
+
+struct tasks {
+    usps_config_t cfg;
+    long stack_size;	/* guard page included */
+    Policy *ready;
+    task_t **tasks;
+    long ntasks;
+    long cap;
+    long done;
+    char **pool;	/* stacks of finished tasks */
+    long npool;
+    long pool_cap;
+    task_t *current;
+    uint64_t slice_end;	/* when the current task's quantum is over */
+#ifdef TK_USE_UCONTEXT
+    ucontext_t sched;
+#else
+    void *sched_sp;
+#endif
+};
+
+static Tasks *self;	/* the Tasks whose tk_run_once() is running */
+
+#ifndef TK_USE_UCONTEXT
+/*
+ * saves the callee-saved registers on the current stack, with the MXCSR
+ * and the x87 control word, which the ABI makes callee-saved too, stores
+ * the stack pointer in `*from', and resumes the stack `to' the same way
+ */
+void tk_switch(void **from, void *to);
+__asm__(".text\n"
+        ".globl tk_switch\n"
+        ".hidden tk_switch\n"
+        ".type tk_switch, @function\n"
+        "tk_switch:\n"
+        "    pushq %rbp\n"
+        "    pushq %rbx\n"
+        "    pushq %r12\n"
+        "    pushq %r13\n"
+        "    pushq %r14\n"
+        "    pushq %r15\n"
+        "    subq $8, %rsp\n"
+        "    stmxcsr (%rsp)\n"
+        "    fnstcw 4(%rsp)\n"
+        "    movq %rsp, (%rdi)\n"
+        "    movq %rsi, %rsp\n"
+        "    ldmxcsr (%rsp)\n"
+        "    fldcw 4(%rsp)\n"
+        "    addq $8, %rsp\n"
+        "    popq %r15\n"
+        "    popq %r14\n"
+        "    popq %r13\n"
+        "    popq %r12\n"
+        "    popq %rbx\n"
+        "    popq %rbp\n"
+        "    ret\n"
+        ".size tk_switch, .-tk_switch\n");
+#endif
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static uint64_t quantum_ns(Tasks *t) {
+    int q = (t->cfg.quantum_ms >= 20 && t->cfg.quantum_ms <= 1000) ? t->cfg.quantum_ms : 20;
+
+    return (uint64_t)q * 1000000ULL;
+}
+
+Tasks *tk_create(usps_config_t *cfg, long stack_size) {
+    long page = sysconf(_SC_PAGESIZE);
+    Tasks *t;
+
+    if ((cfg->policy != USPS_RR && cfg->policy != USPS_FIFO)
+        || (cfg->policy == USPS_RR && (cfg->quantum_ms < 20 || cfg->quantum_ms > 1000))
+        || stack_size < 0) {
+        p1putstr(2, "usps: invalid configuration (the quantum is 20 .. 1000 ms)\n");
+        return NULL;
+    }
+    if ((t = (Tasks *)calloc(1, sizeof(Tasks))) == NULL)
+        return NULL;
+    t->cfg = *cfg;
+    if (stack_size == 0)
+        stack_size = TK_STACK_SIZE;
+    t->stack_size = ((stack_size + page - 1) / page + 1) * page;
+    if ((t->ready = pol_create(0L)) == NULL) {
+        free(t);
+        return NULL;
+    }
+    return t;
+}
+
+void tk_destroy(Tasks *t) {
+    long i;
+
+    for (i = 0; i < t->ntasks; i++) {
+        if (t->tasks[i]->stack != NULL)
+            munmap(t->tasks[i]->stack, t->stack_size);
+        free(t->tasks[i]);
+    }
+    for (i = 0; i < t->npool; i++)
+        munmap(t->pool[i], t->stack_size);
+    if (self == t)
+        self = NULL;
+    free(t->tasks);
+    free(t->pool);
+    pol_destroy(t->ready);
+    free(t);
+}
+
+long tk_spawn(Tasks *t, void (*fn)(void *arg), void *arg, int prio) {
+    task_t *task;
+
+    if (t->ntasks == t->cap) {
+        long cap = (t->cap == 0) ? 64 : 2 * t->cap;
+        task_t **tasks = (task_t **)realloc(t->tasks, cap * sizeof(task_t *));
+
+        if (tasks == NULL)
+            return -1L;
+        t->tasks = tasks;
+        t->cap = cap;
+    }
+    if ((task = (task_t *)calloc(1, sizeof(task_t))) == NULL)
+        return -1L;
+    task->id = t->ntasks;
+    task->state = USPS_READY;
+    task->prio = prio;
+    task->fn = fn;
+    task->arg = arg;
+    if (!pol_ready(t->ready, task, prio, 0L)) {
+        free(task);
+        return -1L;
+    }
+    t->tasks[t->ntasks++] = task;
+    return task->id;
+}
+
+/*
+ * where a task starts: runs its function, then goes back to the scheduler
+ * for good
+ */
+static void entry(void) {
+    task_t *task = self->current;
+
+    (*task->fn)(task->arg);
+    task->state = USPS_DONE;
+#ifdef TK_USE_UCONTEXT
+    setcontext(&self->sched);
+#else
+    {
+        void *dead;
+
+        tk_switch(&dead, self->sched_sp);
+    }
+#endif
+}
+
+/*
+ * gives `task' a stack from the pool, or a new one, set up to start in entry()
+ */
+static int give_stack(Tasks *t, task_t *task) {
+    long page = sysconf(_SC_PAGESIZE);
+
+    if (t->npool > 0)
+        task->stack = t->pool[--t->npool];
+    else {
+        char *stack = (char *)mmap(NULL, t->stack_size, PROT_READ | PROT_WRITE,
+                                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+
+        if (stack == MAP_FAILED) {
+            p1perror(2, "usps: task stack");
+            return 0;
+        }
+        if (mprotect(stack, page, PROT_NONE) == -1) {	/* guard page: overflow faults */
+            p1perror(2, "usps: task stack guard");
+            munmap(stack, t->stack_size);
+            return 0;
+        }
+        task->stack = stack;
+    }
+#ifdef TK_USE_UCONTEXT
+    getcontext(&task->ctx);
+    task->ctx.uc_stack.ss_sp = task->stack + page;
+    task->ctx.uc_stack.ss_size = t->stack_size - page;
+    task->ctx.uc_link = NULL;
+    makecontext(&task->ctx, entry, 0);
+#else
+    {
+        void **sp = (void **)(task->stack + t->stack_size);	/* 16-byte aligned */
+        int i;
+
+        *--sp = NULL;			/* entry()'s return address, never used */
+        *--sp = (void *)entry;		/* where tk_switch() returns to */
+        for (i = 0; i < 6; i++)
+            *--sp = NULL;		/* rbp, rbx, r12 .. r15 */
+        *--sp = (void *)TK_FP_CONTROL;	/* a task starts with the ABI's defaults */
+        task->sp = sp;
+    }
+#endif
+    return 1;
+}
+
+/*
+ * puts the stack of a finished task back in the pool
+ */
+static void take_stack(Tasks *t, task_t *task) {
+    if (t->npool == t->pool_cap) {
+        long cap = (t->pool_cap == 0) ? 16 : 2 * t->pool_cap;
+        char **pool = (char **)realloc(t->pool, cap * sizeof(char *));
+
+        if (pool == NULL) {
+            munmap(task->stack, t->stack_size);
+            task->stack = NULL;
+            return;
+        }
+        t->pool = pool;
+        t->pool_cap = cap;
+    }
+    t->pool[t->npool++] = task->stack;
+    task->stack = NULL;
+}
+
+long tk_run_once(Tasks *t) {
+    uint64_t start = now_ns(), q = quantum_ns(t);
+    task_t *task;
+
+    self = t;
+    while (pol_next(t->ready, (void **)&task)) {
+        if (task->stack == NULL && !give_stack(t, task)) {
+            pol_ready(t->ready, task, task->prio, 0L);	/* there is room: it was taken off */
+            return -1L;
+        }
+        task->state = USPS_RUNNING;
+        t->current = task;
+        t->slice_end = now_ns() + q;
+#ifdef TK_USE_UCONTEXT
+        swapcontext(&t->sched, &task->ctx);
+#else
+        tk_switch(&t->sched_sp, task->sp);
+#endif
+        t->current = NULL;
+        if (task->state == USPS_DONE) {
+            take_stack(t, task);
+            t->done++;
+        } else {
+            task->state = USPS_READY;
+            if (!pol_ready(t->ready, task, task->prio, 0L))
+                return -1L;
+        }
+        if (now_ns() - start >= q)
+            break;
+    }
+    return t->ntasks - t->done;
+}
+
+int tk_run(Tasks *t) {
+    long left;
+
+    while ((left = tk_run_once(t)) > 0)
+        ;
+    return left == 0;
+}
+
+void tk_yield(void) {
+    task_t *task;
+
+    if (self == NULL || (task = self->current) == NULL)
+        return;
+#ifdef TK_USE_UCONTEXT
+    swapcontext(&task->ctx, &self->sched);
+#else
+    tk_switch(&task->sp, self->sched_sp);
+#endif
+}
+
+void tk_check(void) {
+    if (self != NULL && self->current != NULL && self->cfg.policy == USPS_RR && now_ns() >= self->slice_end)
+        tk_yield();
+}
+
+int tk_state(Tasks *t, long id) {
+    return (id >= 0 && id < t->ntasks) ? t->tasks[id]->state : -1;
+}
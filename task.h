@@ -0,0 +1,98 @@
+#ifndef _TASK_H_
+#define _TASK_H_
+
+/*
+ * interface definition for in-process tasks, part of libusps
+ *
+ * a task is a function call run on a stackful coroutine in the caller's
+ * thread, for work too short to be worth a fork() and exec(); tasks are
+ * picked through the same ready queue (policy.h) and configuration as
+ * libusps jobs:
+ *
+ *	USPS_RR    a task's turn lasts one quantum; it gives the rest of the
+ *	           CPU up at its next tk_check() once the quantum is over, or
+ *	           at any tk_yield()
+ *	USPS_FIFO  a task runs until it is done or calls tk_yield()
+ *
+ * the quantum is measured on CLOCK_MONOTONIC (read through the vDSO) at
+ * tk_check(), rather than enforced by a timer signal: switching stacks in a
+ * signal handler would interrupt a task in the middle of malloc() or
+ * stdio, so tasks are preempted only at points they choose
+ *
+ * a task's stack is taken from a pool when it is first dispatched and put
+ * back when it is done, so running many short tasks maps stacks only as
+ * often as there are tasks alive at once; each stack has a guard page
+ *
+ * on x86-64 a task switch saves and restores the callee-saved registers
+ * only; elsewhere, or built with -DTK_UCONTEXT, it uses swapcontext(),
+ * which also switches the signal mask with a system call
+ *
+ * tasks are not thread-safe: one thread runs a Tasks at a time, and
+ * tk_yield() and tk_check() act on the one whose tk_run_once() is running
+ */
+
+#include "usps.h"
+
+#define TK_STACK_SIZE (64L * 1024L)	/* default; a guard page is added */
+
+typedef struct tasks Tasks;		/* opaque type definition */
+
+/*
+ * creates a set of tasks scheduled by the policy and quantum in `cfg'
+ * (slots and engine do not apply), on stacks of `stack_size' bytes
+ * (TK_STACK_SIZE if 0L)
+ *
+ * returns a pointer to it, or NULL if the configuration is invalid or
+ * there are malloc() errors
+ */
+Tasks *tk_create(usps_config_t *cfg, long stack_size);
+
+/*
+ * destroys the tasks and their stacks; tasks that are not done never
+ * resume, and what they hold is not freed
+ */
+void tk_destroy(Tasks *t);
+
+/*
+ * registers a task that calls fn(arg), ready with priority `prio' (lower
+ * runs first)
+ *
+ * returns its id (0, 1, ... in order), or -1 if there are malloc() errors
+ */
+long tk_spawn(Tasks *t, void (*fn)(void *arg), void *arg, int prio);
+
+/*
+ * runs ready tasks, turn by turn, until none is ready or one quantum has
+ * gone by (so that the caller's event loop keeps going); must not be
+ * called from a task
+ *
+ * returns the number of tasks that are not done, or -1 if a stack cannot
+ * be mapped
+ */
+long tk_run_once(Tasks *t);
+
+/*
+ * calls tk_run_once() until every task is done
+ *
+ * returns 1 if successful, 0 if a stack cannot be mapped
+ */
+int tk_run(Tasks *t);
+
+/*
+ * from a task: ends its turn; it is ready again, behind the tasks of the
+ * same priority; outside a task, does nothing
+ */
+void tk_yield(void);
+
+/*
+ * from a task: ends its turn if its quantum is over (USPS_RR)
+ */
+void tk_check(void);
+
+/*
+ * returns the state of task `id' (USPS_READY ... USPS_DONE), or -1 if there
+ * is no such task
+ */
+int tk_state(Tasks *t, long id);
+
+#endif /* _TASK_H_ */
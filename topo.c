@@ -0,0 +1,195 @@
+/*
+ * implementation for the CPU topology reader
+ */
+
+#include "topo.h"
+#include "p1fxns.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define PATH_SIZE 256
+
+static char *root(void) {
+    char *r = getenv("USPS_SYSFS");
+
+    return (r != NULL) ? r : "/sys";
+}
+
+/*
+ * builds <root>/devices/system/cpu/cpu<cpu><rest> (no cpu<cpu> if cpu < 0)
+ */
+static void cpu_path(char *path, int cpu, char *rest) {
+    char num[25];
+
+    p1strcpy(path, root());
+    p1strcat(path, "/devices/system/cpu/");
+    if (cpu >= 0) {
+        p1strcat(path, "cpu");
+        p1ltoa((long)cpu, num);
+        p1strcat(path, num);
+    }
+    p1strcat(path, rest);
+}
+
+/*
+ * reads a small sysfs file into buf, without the trailing newline
+ *
+ * returns 1 if successful, 0 if not
+ */
+static int read_file(char *path, char *buf, int size) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    int n;
+
+    if (fd == -1)
+        return 0;
+    n = read(fd, buf, size - 1);
+    close(fd);
+    if (n <= 0)
+        return 0;
+    if (buf[n - 1] == '\n')
+        n--;
+    buf[n] = '\0';
+    return 1;
+}
+
+/*
+ * parses the range at s, "a" or "a-b", into *lo and *hi
+ *
+ * returns the text after it and its comma, or NULL at the end of the list
+ */
+static char *next_range(char *s, int *lo, int *hi) {
+    if (*s < '0' || *s > '9')
+        return NULL;
+    *lo = *hi = p1atoi(s);
+    while (*s >= '0' && *s <= '9')
+        s++;
+    if (*s == '-') {
+        *hi = p1atoi(++s);
+        while (*s >= '0' && *s <= '9')
+            s++;
+    }
+    return (*s == ',') ? s + 1 : s;
+}
+
+/*
+ * returns the lowest CPU in the list file `path', or `dflt' if it can't
+ * be read
+ */
+static int first_cpu(char *path, int dflt) {
+    char buf[1024];
+    int lo, hi;
+
+    if (!read_file(path, buf, sizeof(buf)) || next_range(buf, &lo, &hi) == NULL)
+        return dflt;
+    return lo;
+}
+
+static int node_of(int cpu) {
+    char path[PATH_SIZE];
+    DIR *dir;
+    struct dirent *d;
+    int node = 0;
+
+    cpu_path(path, cpu, "");
+    if ((dir = opendir(path)) == NULL)
+        return 0;
+    while ((d = readdir(dir)) != NULL) {	/* the node<N> link */
+        if (p1strneq(d->d_name, "node", 4) && d->d_name[4] >= '0' && d->d_name[4] <= '9') {
+            node = p1atoi(d->d_name + 4);
+            break;
+        }
+    }
+    closedir(dir);
+    return (node < TOPO_MAX_NODES) ? node : TOPO_MAX_NODES - 1;
+}
+
+static int llc_of(int cpu) {
+    char path[PATH_SIZE], buf[48], num[25];
+    int i, level, best = -1, llc = 0;
+
+    for (i = 0; ; i++) {
+        p1strcpy(buf, "/cache/index");
+        p1ltoa((long)i, num);
+        p1strcat(buf, num);
+        p1strcat(buf, "/level");
+        cpu_path(path, cpu, buf);
+        if (!read_file(path, num, sizeof(num)))
+            break;
+        if ((level = p1atoi(num)) > best) {
+            best = level;
+            path[p1strlen(path) - 5] = '\0';	/* ".../index<i>/" */
+            p1strcat(path, "shared_cpu_list");
+            llc = first_cpu(path, cpu);
+        }
+    }
+    return (best == -1) ? 0 : llc;	/* no cache information: one group */
+}
+
+int topo_read(topo_cpu_t *cpus, int max) {
+    char path[PATH_SIZE], buf[1024], *s;
+    int n = 0, lo, hi, cpu;
+
+    cpu_path(path, -1, "online");
+    if (read_file(path, buf, sizeof(buf))) {
+        for (s = buf; n < max && (s = next_range(s, &lo, &hi)) != NULL; ) {
+            for (cpu = lo; cpu <= hi && n < max; cpu++) {
+                cpus[n].cpu = cpu;
+                cpus[n].node = node_of(cpu);
+                cpus[n].llc = llc_of(cpu);
+                cpu_path(path, cpu, "/topology/thread_siblings_list");
+                cpus[n].core = first_cpu(path, cpu);
+                n++;
+            }
+        }
+    }
+    if (n == 0) {
+        cpus[0].cpu = cpus[0].node = cpus[0].llc = cpus[0].core = 0;
+        n = 1;
+    }
+    return n;
+}
+
+int topo_nodes(topo_cpu_t *cpus, int n) {
+    int i, nodes = 1;
+
+    for (i = 0; i < n; i++)
+        if (cpus[i].node + 1 > nodes)
+            nodes = cpus[i].node + 1;
+    return nodes;
+}
+
+void topo_pick(topo_cpu_t *cpus, int n, int want, topo_cpu_t *out) {
+    int nodes = topo_nodes(cpus, n);
+    int k = 0;
+
+    while (k < want) {
+        char used[TOPO_MAX_CPUS] = {0};
+        int sibling;
+
+        for (sibling = 0; sibling < 2; sibling++) {	/* first threads, then the rest */
+            int took = 1;
+
+            while (took && k < want) {	/* a round: one CPU per node */
+                int node;
+
+                took = 0;
+                for (node = 0; node < nodes && k < want; node++) {
+                    int i;
+
+                    for (i = 0; i < n; i++) {
+                        if (!used[i] && cpus[i].node == node
+                            && (cpus[i].core != cpus[i].cpu) == sibling)
+                            break;
+                    }
+                    if (i < n) {
+                        used[i] = 1;
+                        out[k++] = cpus[i];
+                        took = 1;
+                    }
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,49 @@
+#ifndef _TOPO_H_
+#define _TOPO_H_
+
+/*
+ * interface definition for the CPU topology reader
+ *
+ * the topology comes from sysfs: a CPU's NUMA node is N of the node<N>
+ * link in its devices/system/cpu/cpu<C> directory, its core is the lowest
+ * CPU of its topology/thread_siblings_list (so SMT siblings share a core),
+ * and its last-level cache group is the lowest CPU of the shared_cpu_list
+ * of its highest cache level; a machine without NUMA or cache information
+ * is one node and one group
+ *
+ * the root of the tree is /sys, or $USPS_SYSFS if set (for testing on a
+ * copied or made-up tree)
+ */
+
+#define TOPO_MAX_CPUS 1024
+#define TOPO_MAX_NODES 16	/* nodes beyond these are folded into the last */
+
+typedef struct topo_cpu {
+    int cpu;		/* as numbered by the kernel */
+    int node;		/* NUMA node, 0 .. TOPO_MAX_NODES-1 */
+    int llc;		/* last-level cache group: lowest CPU sharing it */
+    int core;		/* physical core: lowest CPU among its SMT siblings */
+} topo_cpu_t;
+
+/*
+ * reads the online CPUs into cpus[0 .. max-1]
+ *
+ * returns how many were read, at least 1: if sysfs cannot be read, a single
+ * CPU 0 on node 0
+ */
+int topo_read(topo_cpu_t *cpus, int max);
+
+/*
+ * returns the number of nodes spanned by cpus[0 .. n-1] (highest node + 1)
+ */
+int topo_nodes(topo_cpu_t *cpus, int n);
+
+/*
+ * chooses `want' CPUs out of cpus[0 .. n-1] into out[], in the order they
+ * should be filled: one thread of every core before any SMT sibling, and
+ * alternating between nodes, so that a few jobs get cores and caches of
+ * their own; if `want' exceeds n, CPUs are chosen again in the same order
+ */
+void topo_pick(topo_cpu_t *cpus, int n, int want, topo_cpu_t *out);
+
+#endif /* _TOPO_H_ */
@@ -0,0 +1,322 @@
+/*
+ * converts a binary scheduling-event trace (see tracer.h) into Chrome Trace
+ * Event JSON, which both chrome://tracing and the Perfetto UI open
+ *
+ * usage: ./usps-trace2json [trace_file [json_file]]
+ *
+ * the trace is streamed: memory use grows with the number of jobs and CPU
+ * slots, never with the length of the trace
+ *
+ * the output has one track per CPU slot (process "CPUs") and one per job
+ * (process "jobs"); running periods are slices on both, the gaps between a
+ * preemption and the next dispatch are "switch" slices on the CPU track,
+ * and each preemption is a flow arrow from the preempted job to the job
+ * dispatched next on that CPU
+ */
+
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "p1fxns.h"
+#include "tracer.h"
+
+#define CONV_USAGE "usage: ./usps-trace2json [trace_file [json_file]]\n"
+#define IO_SIZE 65536
+#define PID_CPUS 1
+#define PID_JOBS 2
+
+typedef struct track {
+    int named;		/* thread_name metadata emitted */
+    int running;	/* a slice is open */
+    uint64_t since;	/* when the open slice (or I/O, or idle gap) began */
+    int io;		/* job is blocked on I/O (simulation only) */
+    int flow;		/* for a CPU: pending preemption flow id, 0 if none */
+} track_t;
+
+typedef struct tracks {
+    track_t *t;
+    long n;
+} tracks_t;
+
+static char inbuf[IO_SIZE];
+static int inlen, inpos, infd;
+static char outbuf[IO_SIZE];
+static int outlen, outfd;
+static uint64_t base;		/* timestamp of the first event */
+static int first_event = 1;
+static int flows;
+
+static void out_flush(void) {
+    char *p = outbuf;
+
+    while (outlen > 0) {
+        int w = write(outfd, p, outlen);
+
+        if (w <= 0) {
+            p1perror(2, "Error occured while writing output");
+            exit(1);
+        }
+        p += w;
+        outlen -= w;
+    }
+}
+
+static void out_str(char *s) {
+    while (*s != '\0') {
+        if (outlen == IO_SIZE)
+            out_flush();
+        outbuf[outlen++] = *s++;
+    }
+}
+
+static void out_long(long n) {
+    char buf[25];
+
+    p1ltoa(n, buf);
+    out_str(buf);
+}
+
+/*
+ * nsec as trace-event time: usec with three decimals
+ */
+static void out_usec(uint64_t ns) {
+    char frac[8];
+    char buf[8];
+
+    out_long((long)(ns / 1000));
+    out_str(".");
+    p1ltoa((long)(ns % 1000), frac);
+    p1strpack(frac, -3, '0', buf);
+    out_str(buf);
+}
+
+/*
+ * timestamps are relative to the first event
+ */
+static void out_ts(uint64_t ns) {
+    out_usec((ns > base) ? ns - base : 0);
+}
+
+static void out_begin(void) {
+    if (!first_event)
+        out_str(",\n");
+    first_event = 0;
+}
+
+static void out_meta(int pid, long tid, char *what, char *prefix, long n) {
+    out_begin();
+    out_str("{\"ph\":\"M\",\"pid\":");
+    out_long(pid);
+    if (tid >= 0) {
+        out_str(",\"tid\":");
+        out_long(tid);
+    }
+    out_str(",\"name\":\"");
+    out_str(what);
+    out_str("\",\"args\":{\"name\":\"");
+    out_str(prefix);
+    if (n >= 0)
+        out_long(n);
+    out_str("\"}}");
+}
+
+static void out_slice(int pid, long tid, char *name, uint64_t from, uint64_t to) {
+    out_begin();
+    out_str("{\"ph\":\"X\",\"pid\":");
+    out_long(pid);
+    out_str(",\"tid\":");
+    out_long(tid);
+    out_str(",\"name\":\"");
+    out_str(name);
+    out_str("\",\"ts\":");
+    out_ts(from);
+    out_str(",\"dur\":");
+    out_usec((to > from) ? to - from : 0);	/* records may arrive out of order */
+    out_str("}");
+}
+
+static void out_instant(long tid, char *name, uint64_t ts, char *key, long arg) {
+    out_begin();
+    out_str("{\"ph\":\"i\",\"s\":\"t\",\"pid\":");
+    out_long(PID_JOBS);
+    out_str(",\"tid\":");
+    out_long(tid);
+    out_str(",\"name\":\"");
+    out_str(name);
+    out_str("\",\"ts\":");
+    out_ts(ts);
+    out_str(",\"args\":{\"");
+    out_str(key);
+    out_str("\":");
+    out_long(arg);
+    out_str("}}");
+}
+
+static void out_flow(char *ph, long tid, long id, uint64_t ts) {
+    out_begin();
+    out_str("{\"ph\":\"");
+    out_str(ph);
+    out_str("\",\"bp\":\"e\",\"cat\":\"preempt\",\"name\":\"preempt\",\"pid\":");
+    out_long(PID_JOBS);
+    out_str(",\"tid\":");
+    out_long(tid);
+    out_str(",\"id\":");
+    out_long(id);
+    out_str(",\"ts\":");
+    out_ts(ts);
+    out_str("}");
+}
+
+/*
+ * returns the track for index `i', growing the table as needed
+ */
+static track_t *track(tracks_t *ts, long i) {
+    if (i >= ts->n) {
+        long n = (ts->n == 0) ? 64 : ts->n;
+        long j;
+        track_t *tmp;
+
+        while (n <= i)
+            n *= 2;
+        tmp = (track_t *)realloc(ts->t, n * sizeof(track_t));
+        if (tmp == NULL) {
+            p1putstr(2, "Failed to allocate track table\n");
+            exit(1);
+        }
+        for (j = ts->n; j < n; j++) {
+            tmp[j].named = tmp[j].running = tmp[j].io = tmp[j].flow = 0;
+            tmp[j].since = 0;
+        }
+        ts->t = tmp;
+        ts->n = n;
+    }
+    return &ts->t[i];
+}
+
+static int read_full(char *buf, int n) {
+    while (n > 0) {
+        int i;
+
+        if (inpos == inlen) {
+            inlen = read(infd, inbuf, IO_SIZE);
+            inpos = 0;
+            if (inlen <= 0) {
+                inlen = 0;
+                return 0;
+            }
+        }
+        for (i = 0; n > 0 && inpos < inlen; i++, n--)
+            *buf++ = inbuf[inpos++];
+    }
+    return 1;
+}
+
+/*
+ * closes the running slice of `job' on `cpu' at `ns'
+ */
+static void stop_running(track_t *j, long job, track_t *c, long cpu, uint64_t ns) {
+    if (!j->running)
+        return;
+    out_slice(PID_JOBS, job, "running", j->since, ns);
+    out_slice(PID_CPUS, cpu, "running", j->since, ns);
+    j->running = 0;
+    c->running = 0;
+    c->since = ns;	/* start of the gap before the next dispatch */
+}
+
+static void convert_event(tr_event_t *ev, tracks_t *jobs, tracks_t *cpus) {
+    track_t *j, *c;
+
+    if (ev->job < 0 || ev->cpu < 0)
+        return;
+    j = track(jobs, ev->job);
+    c = track(cpus, ev->cpu);
+    if (!j->named) {
+        out_meta(PID_JOBS, ev->job, "thread_name", "job ", ev->job);
+        j->named = 1;
+    }
+    if (!c->named) {
+        out_meta(PID_CPUS, ev->cpu, "thread_name", "cpu ", ev->cpu);
+        c->named = 1;
+        c->since = ev->ns;
+    }
+    switch (ev->type) {
+    case TR_SPAWN:
+        out_instant(ev->job, "spawn", ev->ns, "pid", ev->pid);
+        break;
+    case TR_DISPATCH:
+        if (!c->running && c->since < ev->ns)
+            out_slice(PID_CPUS, ev->cpu, "switch", c->since, ev->ns);
+        if (c->flow) {
+            out_flow("f", ev->job, c->flow, ev->ns);
+            c->flow = 0;
+        }
+        j->running = 1;
+        j->since = ev->ns;
+        c->running = 1;
+        break;
+    case TR_PREEMPT:
+        if (j->running) {
+            c->flow = ++flows;
+            out_flow("s", ev->job, c->flow, (ev->ns > j->since) ? ev->ns - 1 : ev->ns);
+        }
+        stop_running(j, ev->job, c, ev->cpu, ev->ns);
+        break;
+    case TR_BLOCK:
+        stop_running(j, ev->job, c, ev->cpu, ev->ns);
+        j->io = 1;
+        j->since = ev->ns;
+        break;
+    case TR_WAKE:
+        if (j->io)
+            out_slice(PID_JOBS, ev->job, "io", j->since, ev->ns);
+        j->io = 0;
+        break;
+    case TR_EXIT:
+        stop_running(j, ev->job, c, ev->cpu, ev->ns);
+        out_instant(ev->job, "exit", ev->ns, "status", ev->arg);
+        break;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    tr_header_t hdr;
+    tr_event_t ev;
+    tracks_t jobs = {NULL, 0};
+    tracks_t cpus = {NULL, 0};
+
+    infd = 0;
+    outfd = 1;
+    if (argc > 3) {
+        p1putstr(2, CONV_USAGE);
+        return 1;
+    }
+    if (argc > 1 && (infd = open(argv[1], O_RDONLY)) == -1) {
+        p1perror(2, "Error occured while opening trace file");
+        return 1;
+    }
+    if (argc > 2 && (outfd = open(argv[2], O_WRONLY | O_CREAT | O_TRUNC, 0644)) == -1) {
+        p1perror(2, "Error occured while opening output file");
+        return 1;
+    }
+    if (!read_full((char *)&hdr, sizeof(hdr)) || !p1strneq(hdr.magic, TR_MAGIC, 8)
+        || hdr.version != TR_VERSION || hdr.record_size != sizeof(tr_event_t)) {
+        p1putstr(2, "not a uspsv3 trace file, or an unsupported version\n");
+        return 1;
+    }
+
+    out_str("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    out_meta(PID_CPUS, -1, "process_name", "CPUs", -1);
+    out_meta(PID_JOBS, -1, "process_name", "jobs", -1);
+    if (read_full((char *)&ev, sizeof(ev))) {
+        base = ev.ns;
+        do
+            convert_event(&ev, &jobs, &cpus);
+        while (read_full((char *)&ev, sizeof(ev)));
+    }
+    out_str("\n]}\n");
+    out_flush();
+    free(jobs.t);
+    free(cpus.t);
+    return 0;
+}
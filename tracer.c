@@ -0,0 +1,186 @@
+/*
+ * implementation for the scheduling-event tracer
+ *
+ * the ring is a power-of-two array of events plus a parallel array of
+ * commit sequence numbers; a writer reserves a slot by advancing `head'
+ * with compare-and-swap, fills it in, then publishes it by storing
+ * position + 1 into its sequence number; the flusher only consumes slots
+ * that have been published, so a handler interrupting another writer (or
+ * the flusher) never exposes a half-written event
+ *
+ * tr_record() reads the clock inside the reservation loop: a handler that
+ * records between the reading and the compare-and-swap makes it fail, and
+ * the retry reads the clock again, so the ring stays in time order
+ */
+
+#include "tracer.h"
+#include "p1fxns.h"
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+
+static tr_event_t *events = NULL;
+static uint64_t *seqs = NULL;
+static uint64_t mask;
+static uint64_t head;		/* next position to reserve */
+static uint64_t tail;		/* next position to write to the file */
+static uint64_t dropped;
+static int trace_fd = -1;
+
+uint64_t tr_now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int write_all(int fd, char *buf, long n) {
+    while (n > 0) {
+        long w = write(fd, buf, n);
+
+        if (w <= 0)
+            return 0;
+        buf += w;
+        n -= w;
+    }
+    return 1;
+}
+
+int tr_open(char *path, long capacity) {
+    tr_header_t hdr;
+    uint64_t cap = 1;
+    uint64_t i;
+
+    if (capacity <= 0L)
+        capacity = DEFAULT_TRACE_EVENTS;
+    while (cap < (uint64_t)capacity)
+        cap <<= 1;
+    events = (tr_event_t *)malloc(cap * sizeof(tr_event_t));
+    seqs = (uint64_t *)malloc(cap * sizeof(uint64_t));
+    if (events == NULL || seqs == NULL) {
+        p1putstr(2, "Failed to allocate trace buffer\n");
+        goto fail;
+    }
+    for (i = 0; i < cap; i++)
+        seqs[i] = 0;
+    trace_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (trace_fd == -1) {
+        p1perror(2, "Error occured while opening trace file");
+        goto fail;
+    }
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, TR_MAGIC, sizeof(hdr.magic));
+    hdr.version = TR_VERSION;
+    hdr.record_size = sizeof(tr_event_t);
+    if (!write_all(trace_fd, (char *)&hdr, sizeof(hdr))) {
+        p1perror(2, "Error occured while writing trace file");
+        close(trace_fd);
+        trace_fd = -1;
+        goto fail;
+    }
+    mask = cap - 1;
+    head = tail = dropped = 0;
+    return 1;
+
+fail:
+    free(events);
+    free(seqs);
+    events = NULL;
+    seqs = NULL;
+    return 0;
+}
+
+int tr_enabled(void) {
+    return events != NULL;
+}
+
+/*
+ * reserves a slot and fills it in, stamped with `ns', or with tr_now() as
+ * of the reservation if `now'
+ */
+static void record(int now, uint64_t ns, int type, int job, int pid, int cpu, int arg) {
+    uint64_t pos;
+    tr_event_t *ev;
+
+    pos = __atomic_load_n(&head, __ATOMIC_RELAXED);
+    do {
+        if (now)
+            ns = tr_now();
+        if (pos - __atomic_load_n(&tail, __ATOMIC_ACQUIRE) > mask) {
+            __atomic_fetch_add(&dropped, 1, __ATOMIC_RELAXED);
+            return;
+        }
+    } while (!__atomic_compare_exchange_n(&head, &pos, pos + 1, 0,
+                                          __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+    ev = &events[pos & mask];
+    ev->ns = ns;
+    ev->job = job;
+    ev->pid = pid;
+    ev->cpu = cpu;
+    ev->type = type;
+    ev->arg = arg;
+    __atomic_store_n(&seqs[pos & mask], pos + 1, __ATOMIC_RELEASE);
+}
+
+void tr_record_at(uint64_t ns, int type, int job, int pid, int cpu, int arg) {
+    if (events != NULL)
+        record(0, ns, type, job, pid, cpu, arg);
+}
+
+void tr_record(int type, int job, int pid, int cpu, int arg) {
+    if (events != NULL)
+        record(1, 0, type, job, pid, cpu, arg);
+}
+
+long tr_pending(void) {
+    if (events == NULL)
+        return 0L;
+    return (long)(__atomic_load_n(&head, __ATOMIC_ACQUIRE) - tail);
+}
+
+void tr_flush(void) {
+    uint64_t t;
+
+    if (events == NULL)
+        return;
+    t = tail;
+    for (;;) {
+        uint64_t n = 0;
+
+        /* the longest published run that does not wrap around the ring */
+        while (((t + n) & mask) != 0 || n == 0) {
+            if (__atomic_load_n(&seqs[(t + n) & mask], __ATOMIC_ACQUIRE) != t + n + 1)
+                break;
+            n++;
+        }
+        if (n == 0)
+            break;
+        if (!write_all(trace_fd, (char *)&events[t & mask], n * sizeof(tr_event_t)))
+            p1perror(2, "Error occured while writing trace file");
+        t += n;
+        __atomic_store_n(&tail, t, __ATOMIC_RELEASE);
+    }
+}
+
+void tr_close(void) {
+    tr_event_t *ev = events;
+    uint64_t *sq = seqs;
+
+    if (events == NULL)
+        return;
+    tr_flush();
+    if (dropped > 0) {
+        p1bputstr(2, "tracer: ring buffer full, dropped ");
+        p1bputlong(2, (long)dropped);
+        p1bputstr(2, " events\n");
+        p1bflush(2);
+    }
+    events = NULL;
+    seqs = NULL;
+    close(trace_fd);
+    trace_fd = -1;
+    free(ev);
+    free(sq);
+}
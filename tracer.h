@@ -0,0 +1,94 @@
+#ifndef _TRACER_H_
+#define _TRACER_H_
+
+/*
+ * interface definition for the scheduling-event tracer
+ *
+ * events are written into a preallocated ring buffer by tr_record(), which
+ * is lock-free and async-signal-safe so that the signal handlers which do
+ * the dispatching can call it; tr_flush() drains the ring to the trace file
+ * from ordinary (non-signal) context
+ *
+ * the trace file is a tr_header followed by tr_event records, in the byte
+ * order of the machine that wrote it
+ */
+
+#include <stdint.h>
+
+#define TR_MAGIC "USPSTRC1"
+#define TR_VERSION 1
+#define DEFAULT_TRACE_EVENTS 65536L
+
+/* event types */
+#define TR_SPAWN 1	/* job's process created (or job arrived, when simulating) */
+#define TR_DISPATCH 2	/* job given the CPU */
+#define TR_PREEMPT 3	/* job's time slice expired */
+#define TR_BLOCK 4	/* job started I/O (simulation only) */
+#define TR_WAKE 5	/* job finished I/O (simulation only) */
+#define TR_EXIT 6	/* job terminated; arg is the wait status */
+
+typedef struct tr_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+} tr_header_t;
+
+typedef struct tr_event {
+    uint64_t ns;	/* CLOCK_MONOTONIC, or virtual time when simulating */
+    int32_t job;	/* job index in workload order */
+    int32_t pid;	/* 0 when simulating */
+    int16_t cpu;	/* CPU slot */
+    int16_t type;	/* TR_SPAWN ... TR_EXIT */
+    int32_t arg;
+} tr_event_t;
+
+/*
+ * creates the trace file `path' and a ring buffer of `capacity' events
+ * (DEFAULT_TRACE_EVENTS if capacity is 0L)
+ *
+ * returns 1 if successful, 0 if not (the tracer stays disabled)
+ */
+int tr_open(char *path, long capacity);
+
+/*
+ * returns 1 if tracing is enabled, 0 if not
+ */
+int tr_enabled(void);
+
+/*
+ * returns the current CLOCK_MONOTONIC time in nsec
+ */
+uint64_t tr_now(void);
+
+/*
+ * records an event stamped with tr_now(); async-signal-safe
+ *
+ * events recorded this way, handlers included, are in time order in the ring
+ *
+ * if the ring is full, the event is dropped and counted
+ */
+void tr_record(int type, int job, int pid, int cpu, int arg);
+
+/*
+ * as tr_record(), with an explicit timestamp, which is stored in whatever
+ * order it comes
+ */
+void tr_record_at(uint64_t ns, int type, int job, int pid, int cpu, int arg);
+
+/*
+ * returns the number of recorded events not yet written to the file
+ */
+long tr_pending(void);
+
+/*
+ * writes all recorded events to the trace file; not async-signal-safe
+ */
+void tr_flush(void);
+
+/*
+ * flushes, reports dropped events on fd 2, closes the file and releases
+ * the ring buffer
+ */
+void tr_close(void);
+
+#endif /* _TRACER_H_ */
@@ -0,0 +1,141 @@
+/*
+ * compiles a workload file into an image the scheduler maps and launches
+ * from without parsing it, see workload.h
+ *
+ * usage: ./usps-compile <workload_file> <image>
+ *
+ * the dependencies given by name= and after= are checked the way the
+ * scheduler would check them, so that a bad workload fails here
+ */
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "p1fxns.h"
+#include "workload.h"
+#include "dag.h"
+
+#define COMPILE_USAGE "usage: ./usps-compile <workload_file> <image>\n"
+
+/*
+ * the names and dependencies of the jobs that are not job arrays, for the
+ * check; they keep their own copies, wl_free() is called on every line
+ */
+typedef struct deps {
+    char **names;
+    char **afters;
+    long n;
+    long cap;
+    int any;
+} deps_t;
+
+static int add_deps(deps_t *d, wl_line_t *l) {
+    if (d->n == d->cap) {
+        long cap = (d->cap == 0) ? 64 : 2 * d->cap;
+        char **names = (char **)realloc(d->names, cap * sizeof(char *));
+        char **afters;
+
+        if (names == NULL)
+            return 0;
+        d->names = names;
+        if ((afters = (char **)realloc(d->afters, cap * sizeof(char *))) == NULL)
+            return 0;
+        d->afters = afters;
+        d->cap = cap;
+    }
+    d->names[d->n] = d->afters[d->n] = NULL;
+    d->n++;
+    if ((l->name != NULL && (d->names[d->n - 1] = p1strdup(l->name)) == NULL)
+        || (l->after != NULL && (d->afters[d->n - 1] = p1strdup(l->after)) == NULL))
+        return 0;
+    d->any |= (l->name != NULL || l->after != NULL);
+    return 1;
+}
+
+static int check_deps(deps_t *d) {
+    Dag *dag;
+    long i;
+    int ok;
+
+    if (!d->any)
+        return 1;
+    if ((dag = dag_create(d->n)) == NULL) {
+        p1putstr(2, "usps-compile: out of memory\n");
+        return 0;
+    }
+    for (i = 0; i < d->n; i++)
+        dag_set(dag, i, d->names[i], d->afters[i]);
+    ok = dag_build(dag);	/* reports what is wrong */
+    dag_destroy(dag);
+    return ok;
+}
+
+static void free_deps(deps_t *d) {
+    long i;
+
+    for (i = 0; i < d->n; i++) {
+        free(d->names[i]);
+        free(d->afters[i]);
+    }
+    free(d->names);
+    free(d->afters);
+}
+
+int main(int argc, char *argv[]) {
+    char line[WL_LINE_MAX];
+    deps_t d = {NULL, NULL, 0L, 0L, 0};
+    WlWriter *w;
+    wl_line_t l;
+    int in, out, r, ok = 0;
+
+    if (argc != 3) {
+        p1putstr(2, COMPILE_USAGE);
+        return 1;
+    }
+    if ((in = open(argv[1], O_RDONLY)) == -1) {
+        p1perror(2, argv[1]);
+        return 1;
+    }
+    if ((w = wl_writer_create()) == NULL) {
+        p1putstr(2, "usps-compile: out of memory\n");
+        close(in);
+        return 1;
+    }
+    while (p1getline(in, line, WL_LINE_MAX)) {
+        if ((r = wl_parse(line, &l)) == 0)
+            continue;
+        if (r == -1) {
+            p1putstr(2, "usps-compile: out of memory\n");
+            goto out;
+        }
+        if (l.first <= l.last && (l.name != NULL || l.after != NULL)) {
+            p1putstr(2, "workload: a job array cannot have name= or after=\n");
+            wl_free(&l);
+            goto out;
+        }
+        r = wl_writer_add(w, &l) && (l.first <= l.last || add_deps(&d, &l));
+        wl_free(&l);
+        if (!r) {
+            p1putstr(2, "usps-compile: out of memory, or the image is too large\n");
+            goto out;
+        }
+    }
+    if (!check_deps(&d))
+        goto out;
+    if ((out = open(argv[2], O_WRONLY | O_CREAT | O_TRUNC, 0644)) == -1) {
+        p1perror(2, argv[2]);
+        goto out;
+    }
+    ok = wl_writer_write(w, out);
+    if (close(out) == -1 && ok) {
+        p1perror(2, argv[2]);
+        ok = 0;
+    }
+    if (!ok)
+        unlink(argv[2]);
+out:
+    wl_writer_destroy(w);
+    free_deps(&d);
+    close(in);
+    return !ok;
+}
@@ -0,0 +1,75 @@
+/*
+ * usps-example: the C++ interface (usps.hpp) in one event loop
+ *
+ *     usps-example <command> [<command>]...
+ *
+ * runs each command, split at spaces, as a job, two at a time with a 50 ms
+ * quantum, and two counting tasks beside them, then writes how each job
+ * ended; it exits 1 if any did not exit with 0
+ *
+ * it is built with the rest of the tree, so that usps.hpp keeps compiling
+ * against the library
+ */
+
+#include "usps.hpp"
+#include <iostream>
+#include <sstream>
+#include <poll.h>
+#include <sys/wait.h>
+
+static std::vector<std::string> split(const std::string &line) {
+    std::vector<std::string> words;
+    std::istringstream in(line);
+    std::string w;
+
+    while (in >> w)
+        words.push_back(w);
+    return words;
+}
+
+int main(int argc, char *argv[]) {
+    usps::Config cfg = usps::Config().policy(USPS_RR).quantum_ms(50).slots(2);
+    std::vector<usps::Job> jobs;
+    long counts[2] = {0, 0};
+    int failed = 0;
+
+    if (argc < 2) {
+        std::cerr << "usage: usps-example <command> [<command>]...\n";
+        return 1;
+    }
+    try {
+        usps::Scheduler s(cfg);
+        usps::Tasks t(cfg);
+        struct pollfd pfd;
+
+        for (int i = 1; i < argc; i++)
+            jobs.push_back(s.submit(split(argv[i])));
+        for (long &n : counts)
+            t.spawn([&n] {
+                for (n = 0; n < 1000000; n++)
+                    usps::Tasks::check();
+            });
+        pfd.fd = s.fd();
+        pfd.events = POLLIN;
+        while (s.run_once() > 0) {
+            if (t.run_once() == 0)
+                (void)poll(&pfd, 1, -1);	/* the tasks are done: wait for the jobs */
+        }
+        t.run();
+        for (usps::Job &job : jobs) {
+            int status = job.status();
+
+            std::cout << argv[job.id() + 1] << ": ";
+            if (WIFEXITED(status))
+                std::cout << "exited with " << WEXITSTATUS(status) << "\n";
+            else
+                std::cout << "killed by signal " << WTERMSIG(status) << "\n";
+            failed |= !(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+        }
+        std::cout << "tasks counted to " << counts[0] << " and " << counts[1] << "\n";
+    } catch (const usps::Error &e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+    return failed;
+}
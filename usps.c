@@ -0,0 +1,412 @@
+/*
+ * implementation for libusps
+ *
+ * jobs are allocated one by one, as the ready queue holds pointers to them;
+ * the table of those pointers, and the reaping of their processes, are
+ * jobtab.h's, shared with uspsv3
+ *
+ * the running jobs are also linked in a list of their own, so that a tick
+ * looks only at them, the ready queue and the jobs that have exited
+ */
+
+#include "usps.h"
+#include "jobtab.h"
+#include "policy.h"
+#include "launch.h"
+#include "soft.h"
+#include "workload.h"
+#include "p1fxns.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+#include <sys/wait.h>
+
+#define USPS_POLL_MS 20		/* USPS_FIFO: how often jobs are looked for */
+
+typedef struct job {
+    long id;
+    int state;		/* USPS_READY ... USPS_DONE */
+    int started;	/* its gate has been opened */
+    int prio;
+    int ticks;		/* USPS_RR: quanta left in its turn */
+    int status;		/* wait status once USPS_DONE */
+    char **args;	/* NULL-terminated, owned */
+    ln_child_t ln;
+    sf_job_t sf;	/* with a soft backend */
+    struct job *prev;	/* on the running list while USPS_RUNNING */
+    struct job *next;
+} job_t;
+
+struct usps_sched {
+    usps_config_t cfg;
+    Policy *ready;
+    JobTab *tab;
+    job_t *running_list;	/* in dispatch order, so a turn ends in that order */
+    job_t *running_tail;
+    long running;
+    long done;
+    int timer;
+};
+
+void usps_defaults(usps_config_t *cfg) {
+    cfg->policy = USPS_RR;
+    cfg->quantum_ms = 100;
+    cfg->slots = 1;
+    cfg->engine = LN_FORK;
+    cfg->backend = USPS_SIGNAL;
+}
+
+Usps *usps_create(usps_config_t *cfg) {
+    struct itimerspec period;
+    sigset_t usr1;
+    long ms;
+    Usps *u;
+
+    if ((cfg->policy != USPS_RR && cfg->policy != USPS_FIFO)
+        || (cfg->policy == USPS_RR && (cfg->quantum_ms < 20 || cfg->quantum_ms > 1000))
+        || cfg->slots < 0 || cfg->engine < LN_FORK || cfg->engine > LN_ZYGOTE
+        || cfg->backend < USPS_SIGNAL || cfg->backend > USPS_CGROUP) {
+        p1putstr(2, "usps: invalid configuration (the quantum is 20 .. 1000 ms)\n");
+        return NULL;
+    }
+    if ((u = (Usps *)calloc(1, sizeof(Usps))) == NULL) {
+        p1putstr(2, "usps: out of memory\n");
+        return NULL;
+    }
+    u->cfg = *cfg;
+    u->timer = -1;
+    sigemptyset(&usr1);
+    sigaddset(&usr1, SIGUSR1);
+    sigprocmask(SIG_BLOCK, &usr1, NULL);	/* see launch.h */
+    if ((u->ready = pol_create(0L)) == NULL || (u->tab = jt_create()) == NULL) {
+        p1putstr(2, "usps: out of memory\n");
+        usps_destroy(u);
+        return NULL;
+    }
+    ms = (cfg->policy == USPS_RR) ? cfg->quantum_ms : USPS_POLL_MS;
+    period.it_interval.tv_sec = period.it_value.tv_sec = ms / 1000;
+    period.it_interval.tv_nsec = period.it_value.tv_nsec = (ms % 1000) * 1000000L;
+    if ((u->timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)) == -1
+        || timerfd_settime(u->timer, 0, &period, NULL) == -1) {
+        p1perror(2, "usps: timer");
+        usps_destroy(u);
+        return NULL;
+    }
+    if (cfg->backend != USPS_SIGNAL)
+        u->cfg.backend = sf_open(cfg->backend);
+    if (cfg->engine == LN_ZYGOTE && !ln_server_start()) {
+        usps_destroy(u);
+        return NULL;
+    }
+    return u;
+}
+
+static void free_args(char **args) {
+    int i;
+
+    if (args == NULL)
+        return;
+    for (i = 0; args[i] != NULL; i++)
+        free(args[i]);
+    free(args);
+}
+
+/*
+ * returns job `id', or NULL if there is no such job
+ */
+static job_t *job_at(Usps *u, long id) {
+    return (u->tab == NULL) ? NULL : (job_t *)jt_get(u->tab, id);
+}
+
+void usps_destroy(Usps *u) {
+    job_t *job;
+    long i;
+
+    for (i = 0; (job = job_at(u, i)) != NULL; i++) {
+        if (job->state != USPS_DONE) {
+            kill(job->ln.pid, SIGKILL);
+            while (waitpid(job->ln.pid, &job->status, 0) == -1 && errno == EINTR)
+                ;
+            ln_release(&job->ln);
+            if (u->cfg.backend != USPS_SIGNAL)
+                sf_leave(&job->sf);
+        }
+        free_args(job->args);
+        free(job);
+    }
+    if (u->tab != NULL)
+        jt_destroy(u->tab);
+    if (u->ready != NULL)
+        pol_destroy(u->ready);
+    if (u->timer != -1)
+        close(u->timer);
+    if (u->cfg.engine == LN_ZYGOTE)
+        ln_server_stop();
+    free(u);
+}
+
+static char **copy_args(char **argv) {
+    char **args;
+    int n, i;
+
+    for (n = 0; argv[n] != NULL; n++)
+        ;
+    if ((args = (char **)malloc((n + 1) * sizeof(char *))) == NULL)
+        return NULL;
+    for (i = 0; i < n; i++) {
+        if ((args[i] = p1strdup(argv[i])) == NULL) {
+            args[i] = NULL;
+            free_args(args);
+            return NULL;
+        }
+    }
+    args[n] = NULL;
+    return args;
+}
+
+long usps_submit(Usps *u, char **argv, int prio) {
+    job_t *job;
+
+    if (argv[0] == NULL)
+        return -1L;
+    if (!jt_reserve(u->tab, 1L))
+        goto nomem;
+    if ((job = (job_t *)calloc(1, sizeof(job_t))) == NULL)
+        goto nomem;
+    if ((job->args = copy_args(argv)) == NULL) {
+        free(job);
+        goto nomem;
+    }
+    if (!ln_launch(&job->ln, u->cfg.engine, ln_resolve(job->args[0]), job->args, NULL)) {
+        free_args(job->args);
+        free(job);
+        return -1L;
+    }
+    job->id = jt_add(u->tab, job);	/* reserved above */
+    job->state = USPS_READY;
+    job->prio = prio;
+    job->status = -1;
+    if (!jt_launched(u->tab, job->id, job->ln.pid)) {
+        kill(job->ln.pid, SIGKILL);	/* could not be reaped as a job */
+        while (waitpid(job->ln.pid, &job->status, 0) == -1 && errno == EINTR)
+            ;
+        ln_release(&job->ln);
+        job->state = USPS_DONE;
+        u->done++;
+        goto nomem;
+    }
+    if (u->cfg.backend != USPS_SIGNAL) {
+        sf_join(&job->sf, u->cfg.backend, job->ln.pid, job->id, prio);
+        job->started = 1;
+        ln_start(&job->ln);	/* runs demoted until it has a slot */
+    }
+    if (!pol_ready(u->ready, job, prio, 0L)) {
+        usps_cancel(u, job->id);	/* reaped by the next usps_run_once() */
+        goto nomem;
+    }
+    return job->id;
+nomem:
+    p1putstr(2, "usps: out of memory\n");
+    return -1L;
+}
+
+long usps_load(Usps *u, int fd) {
+    char line[WL_LINE_MAX];
+    long n = 0;
+    wl_line_t l;
+    int r;
+
+    while (p1getline(fd, line, WL_LINE_MAX)) {
+        if ((r = wl_parse(line, &l)) == 0)
+            continue;
+        if (r == -1) {
+            p1putstr(2, "usps: out of memory\n");
+            return -1L;
+        }
+        if (l.first <= l.last || l.gang != NULL || l.name != NULL || l.after != NULL
+            || l.cpu_budget > 0 || l.wall_budget > 0) {
+            p1putstr(2, "workload: job arrays, gangs, dependencies and budgets need uspsv3\n");
+            wl_free(&l);
+            return -1L;
+        }
+        r = (usps_submit(u, l.args, 0) != -1);
+        wl_free(&l);
+        if (!r)
+            return -1L;
+        n++;
+    }
+    return n;
+}
+
+int usps_fd(Usps *u) {
+    return u->timer;
+}
+
+/*
+ * puts `job' at the end of the running list, or takes it off
+ */
+static void link_running(Usps *u, job_t *job) {
+    job->next = NULL;
+    job->prev = u->running_tail;
+    if (job->prev != NULL)
+        job->prev->next = job;
+    else
+        u->running_list = job;
+    u->running_tail = job;
+    u->running++;
+}
+
+static void unlink_running(Usps *u, job_t *job) {
+    if (job->prev != NULL)
+        job->prev->next = job->next;
+    else
+        u->running_list = job->next;
+    if (job->next != NULL)
+        job->next->prev = job->prev;
+    else
+        u->running_tail = job->prev;
+    u->running--;
+}
+
+/*
+ * jt_reap() callback: marks the job that has exited done, and frees its slot
+ */
+static void reaped(void *ctx, jt_event_t *ev) {
+    Usps *u = (Usps *)ctx;
+    job_t *job = job_at(u, ev->id);
+
+    jt_done(u->tab, ev->pid);
+    if (job->state == USPS_RUNNING)
+        unlink_running(u, job);
+    else
+        pol_remove(u->ready, job);	/* cancelled while it waited */
+    job->state = USPS_DONE;
+    job->status = ev->status;
+    ln_release(&job->ln);
+    if (u->cfg.backend != USPS_SIGNAL)
+        sf_leave(&job->sf);
+    u->done++;
+}
+
+long usps_run_once(Usps *u) {
+    uint64_t ticks = 0;
+    job_t *job, *next;
+
+    if (read(u->timer, &ticks, sizeof(ticks)) != sizeof(ticks))
+        ticks = 0;	/* called before the quantum was over */
+    (void)jt_reap(u->tab, 0, &reaped, u);
+    if (u->cfg.policy == USPS_RR && ticks > 0 && pol_size(u->ready) > 0) {
+        for (job = u->running_list; job != NULL; job = next) {
+            next = job->next;
+            if (--job->ticks > 0)
+                continue;
+            if (u->cfg.backend == USPS_SIGNAL)
+                kill(job->ln.pid, SIGSTOP);
+            else
+                sf_share(&job->sf, job->prio, 0);
+            job->state = USPS_READY;
+            unlink_running(u, job);
+            if (!pol_ready(u->ready, job, job->prio, 0L))
+                kill(job->ln.pid, SIGKILL);	/* out of memory: reaped as done */
+        }
+    }
+    while ((u->cfg.slots == 0 || u->running < u->cfg.slots) && pol_next(u->ready, (void **)&job)) {
+        job->state = USPS_RUNNING;
+        job->ticks = 1;
+        link_running(u, job);
+        if (u->cfg.backend != USPS_SIGNAL)
+            sf_share(&job->sf, job->prio, 1);
+        else if (job->started)
+            kill(job->ln.pid, SIGCONT);
+        else {
+            job->started = 1;
+            ln_start(&job->ln);
+        }
+    }
+    return jt_count(u->tab) - u->done;
+}
+
+void usps_run(Usps *u) {
+    struct pollfd pfd;
+
+    pfd.fd = u->timer;
+    pfd.events = POLLIN;
+    while (usps_run_once(u) > 0)
+        (void)poll(&pfd, 1, -1);
+}
+
+long usps_jobs(Usps *u) {
+    return jt_count(u->tab);
+}
+
+int usps_state(Usps *u, long id) {
+    job_t *job = job_at(u, id);
+
+    return (job != NULL) ? job->state : -1;
+}
+
+pid_t usps_pid(Usps *u, long id) {
+    job_t *job = job_at(u, id);
+
+    return (job != NULL) ? job->ln.pid : -1;
+}
+
+int usps_status(Usps *u, long id) {
+    job_t *job = job_at(u, id);
+
+    return (job != NULL) ? job->status : -1;
+}
+
+int usps_cancel(Usps *u, long id) {
+    job_t *job = job_at(u, id);
+
+    if (job == NULL || job->state == USPS_DONE)
+        return 0;
+    kill(job->ln.pid, SIGKILL);
+    return 1;
+}
+
+/*
+ * sets cfg->quantum_ms from the digits at `s'
+ */
+static int set_quantum(char *s, usps_config_t *cfg) {
+    if (s[0] < '0' || s[0] > '9' || (cfg->quantum_ms = p1atoi(s)) < 20 || cfg->quantum_ms > 1000) {
+        p1putstr(2, "The minimum quantum is 20 ms, the maximum quantum is 1000 ms\n");
+        return 0;
+    }
+    return 1;
+}
+
+int usps_cmdline(int argc, char *argv[], char *usage, usps_config_t *cfg) {
+    int i = 1, fd;
+
+    if (argc > 1 && p1strneq(argv[1], "--quantum=", 10)) {
+        if (!set_quantum(argv[1] + 10, cfg))
+            return -1;
+        i++;
+    } else {
+        char *c = getenv("USPS_QUANTUM_MSEC");
+
+        if (c == NULL) {
+            p1putstr(2, usage);
+            p1putstr(2, "environment variable 'USPS_QUANTUM_MSEC' not detected nor specified\n");
+            return -1;
+        }
+        if (!set_quantum(c, cfg))
+            return -1;
+    }
+    if (argc > i + 1 || (i < argc && argv[i][0] == '-')) {
+        p1putstr(2, usage);
+        return -1;
+    }
+    if (i == argc)
+        return 0;	/* standard input */
+    if ((fd = open(argv[i], O_RDONLY)) == -1)
+        p1perror(2, argv[i]);
+    return fd;
+}
@@ -0,0 +1,156 @@
+#ifndef _USPS_H_
+#define _USPS_H_
+
+/*
+ * interface definition for libusps, the embeddable scheduler
+ *
+ * a Usps object owns a job table, a ready queue (policy.h), the launched
+ * jobs' processes and a timer; it does nothing on its own: the caller polls
+ * usps_fd() in its event loop and calls usps_run_once() whenever it is
+ * readable (or at any other time), which reaps the jobs that have exited,
+ * ends the time slices that are over and fills the idle slots
+ *
+ * no signal handlers are installed: jobs are reaped with wait4() on their
+ * own pids (jobtab.h), so the caller's other children are left alone; the caller must
+ * keep SIGUSR1 blocked, see launch.h (usps_create() blocks it in the calling
+ * thread)
+ *
+ * jobs are launched gated when they are submitted, and run their command
+ * from their first dispatch on; with a soft backend (soft.h) they start
+ * at once instead, and a job without a slot is demoted rather than stopped
+ *
+ * uspsv1 and uspsv2 are front ends over this library. uspsv3 is not (yet):
+ * its dispatcher runs from signal handlers and has gangs, dependencies,
+ * budgets and metrics that this one has no hooks for, so only the parser,
+ * ready queue, launch engines, job table and reaper are shared with it
+ *
+ * a call to usps_run_once() looks only at the running jobs, the ready queue
+ * and the jobs that have exited, not at the whole job table (but see
+ * jt_reap() in jobtab.h for an exited child of the caller's own)
+ */
+
+#include <sys/types.h>
+
+/* policies */
+#define USPS_RR 0	/* round robin within priorities, one quantum per turn */
+#define USPS_FIFO 1	/* by priority, then submission; jobs run to the end */
+
+/* job states */
+#define USPS_READY 0	/* launched, waiting for a slot */
+#define USPS_RUNNING 1
+#define USPS_DONE 2	/* reaped; see usps_status() */
+
+/* backends */
+#define USPS_SIGNAL 0	/* jobs without a slot are stopped with SIGSTOP */
+#define USPS_NICE 1	/* ... run at nice 19, see soft.h */
+#define USPS_IDLE 2	/* ... run SCHED_IDLE */
+#define USPS_CGROUP 3	/* ... run in a cgroup of theirs at the lowest weight */
+
+typedef struct usps_sched Usps;	/* opaque type definition */
+
+typedef struct usps_config {
+    int policy;		/* USPS_RR or USPS_FIFO */
+    int quantum_ms;	/* USPS_RR: the time slice, 20 .. 1000 */
+    int slots;		/* jobs running at once; 0 for all of them */
+    int engine;		/* LN_FORK ... LN_ZYGOTE, see launch.h */
+    int backend;	/* USPS_SIGNAL ... USPS_CGROUP */
+} usps_config_t;
+
+/*
+ * fills in `cfg': round robin, 100 ms quantum, one slot, forked jobs,
+ * stopped while they wait
+ */
+void usps_defaults(usps_config_t *cfg);
+
+/*
+ * creates a scheduler configured by `cfg'
+ *
+ * returns a pointer to it, or NULL if the configuration is invalid or
+ * there are malloc() or timer errors (the reason has been written to
+ * standard error)
+ */
+Usps *usps_create(usps_config_t *cfg);
+
+/*
+ * destroys the scheduler; jobs that are not done are killed and reaped
+ */
+void usps_destroy(Usps *u);
+
+/*
+ * launches `argv' (copied) gated and makes it ready with priority `prio'
+ * (lower runs first); a command that cannot be run exits with status
+ * LN_FAILED
+ *
+ * returns the job's id (0, 1, ... in submission order), or -1 if there are
+ * malloc() or launch errors (the reason has been written to standard error)
+ */
+long usps_submit(Usps *u, char **argv, int prio);
+
+/*
+ * submits each job of the workload read from `fd' (see workload.h); the
+ * attributes that need uspsv3 (job arrays, gangs, dependencies, budgets)
+ * are refused
+ *
+ * returns the number of jobs submitted, or -1 (the reason has been written
+ * to standard error; the jobs before the error stay submitted)
+ */
+long usps_load(Usps *u, int fd);
+
+/*
+ * returns a descriptor that becomes readable at every quantum (every 20 ms
+ * with USPS_FIFO), for the caller's poll()
+ */
+int usps_fd(Usps *u);
+
+/*
+ * reaps, preempts and dispatches
+ *
+ * returns the number of jobs that are not done
+ */
+long usps_run_once(Usps *u);
+
+/*
+ * calls usps_run_once() each time usps_fd() is readable until every job is
+ * done
+ */
+void usps_run(Usps *u);
+
+/*
+ * returns the number of jobs submitted
+ */
+long usps_jobs(Usps *u);
+
+/*
+ * returns the state of job `id' (USPS_READY ... USPS_DONE), or -1 if there
+ * is no such job
+ */
+int usps_state(Usps *u, long id);
+
+/*
+ * returns the pid of job `id', or -1 if there is no such job
+ */
+pid_t usps_pid(Usps *u, long id);
+
+/*
+ * returns the wait status of job `id' once it is done, or -1
+ */
+int usps_status(Usps *u, long id);
+
+/*
+ * kills job `id' with SIGKILL; it is done once it has been reaped
+ *
+ * returns 1 if it was not done yet, 0 if not
+ */
+int usps_cancel(Usps *u, long id);
+
+/*
+ * parses the front ends' command line, [--quantum=<msec>] [workload_file]
+ * (the quantum otherwise comes from USPS_QUANTUM_MSEC), into `cfg', and
+ * opens the workload file (standard input if there is none)
+ *
+ * returns the workload's descriptor, or -1 (`usage' or the reason has been
+ * written to standard error)
+ */
+int usps_cmdline(int argc, char *argv[], char *usage, usps_config_t *cfg);
+
+#endif /* _USPS_H_ */
@@ -0,0 +1,225 @@
+#ifndef _USPS_HPP_
+#define _USPS_HPP_
+
+/*
+ * C++ interface to libusps, see usps.h
+ *
+ * a Scheduler owns a Usps object: constructing one creates it, and
+ * destroying one kills and reaps the jobs that are not done; it can be
+ * moved, not copied. submit() returns a Job, a move-only handle to one
+ * job that must not outlive its Scheduler. errors are thrown as
+ * usps::Error
+ *
+ *     usps::Scheduler s(usps::Config().policy(USPS_RR).quantum_ms(50).slots(2));
+ *     usps::Job job = s.submit({"make", "-j4"});
+ *     // in the caller's event loop: poll s.fd() for POLLIN, then
+ *     s.run_once();
+ *     if (job.done()) ... job.status() ...
+ *
+ * Tasks wraps the in-process task mode (task.h) the same way: functions
+ * run on coroutines in the caller's thread, and call Tasks::yield() or
+ * Tasks::check() to let the others run; an exception that escapes a task
+ * calls std::terminate(), as it cannot unwind past the coroutine
+ *
+ * link with -lusps
+ */
+
+#include <exception>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+extern "C" {
+#include "usps.h"
+#include "task.h"
+}
+
+namespace usps {
+
+class Error : public std::runtime_error {
+  public:
+    explicit Error(const std::string &what) : std::runtime_error(what) {}
+};
+
+class Config {
+  public:
+    Config() { usps_defaults(&cfg_); }
+    Config &policy(int p) { cfg_.policy = p; return *this; }
+    Config &quantum_ms(int q) { cfg_.quantum_ms = q; return *this; }
+    Config &slots(int n) { cfg_.slots = n; return *this; }
+    Config &engine(int e) { cfg_.engine = e; return *this; }
+    Config &backend(int b) { cfg_.backend = b; return *this; }
+    const usps_config_t &get() const { return cfg_; }
+
+  private:
+    usps_config_t cfg_;
+};
+
+class Job {
+  public:
+    Job() noexcept : u_(nullptr), id_(-1) {}
+    Job(Job &&other) noexcept : u_(other.u_), id_(other.id_) { other.release(); }
+    Job &operator=(Job &&other) noexcept {
+        u_ = other.u_;
+        id_ = other.id_;
+        if (this != &other)
+            other.release();
+        return *this;
+    }
+    Job(const Job &) = delete;
+    Job &operator=(const Job &) = delete;
+
+    explicit operator bool() const noexcept { return u_ != nullptr; }
+    long id() const noexcept { return id_; }
+    pid_t pid() const { return usps_pid(check(), id_); }
+    int state() const { return usps_state(check(), id_); }
+    bool done() const { return state() == USPS_DONE; }
+    int status() const { return usps_status(check(), id_); }
+    bool cancel() { return usps_cancel(check(), id_) != 0; }
+
+  private:
+    friend class Scheduler;
+    Job(Usps *u, long id) noexcept : u_(u), id_(id) {}
+    void release() noexcept { u_ = nullptr; id_ = -1; }
+    Usps *check() const {
+        if (u_ == nullptr)
+            throw Error("usps: empty Job handle");
+        return u_;
+    }
+
+    Usps *u_;
+    long id_;
+};
+
+class Scheduler {
+  public:
+    explicit Scheduler(const Config &cfg = Config()) {
+        usps_config_t c = cfg.get();
+
+        if ((u_ = usps_create(&c)) == nullptr)
+            throw Error("usps: cannot create the scheduler");
+    }
+    ~Scheduler() {
+        if (u_ != nullptr)
+            usps_destroy(u_);
+    }
+    Scheduler(Scheduler &&other) noexcept : u_(other.u_) { other.u_ = nullptr; }
+    Scheduler &operator=(Scheduler &&other) noexcept {
+        if (this != &other) {
+            if (u_ != nullptr)
+                usps_destroy(u_);
+            u_ = other.u_;
+            other.u_ = nullptr;
+        }
+        return *this;
+    }
+    Scheduler(const Scheduler &) = delete;
+    Scheduler &operator=(const Scheduler &) = delete;
+
+    Job submit(const std::vector<std::string> &argv, int prio = 0) {
+        std::vector<char *> args;
+        long id;
+
+        for (const std::string &a : argv)
+            args.push_back(const_cast<char *>(a.c_str()));	/* copied by usps_submit() */
+        args.push_back(nullptr);
+        if ((id = usps_submit(get(), args.data(), prio)) == -1)
+            throw Error("usps: cannot submit " + (argv.empty() ? std::string("an empty command") : argv[0]));
+        return Job(u_, id);
+    }
+    long load(int fd) {
+        long n = usps_load(get(), fd);
+
+        if (n == -1)
+            throw Error("usps: cannot load the workload");
+        return n;
+    }
+    int fd() const { return usps_fd(get()); }
+    long run_once() { return usps_run_once(get()); }
+    void run() { usps_run(get()); }
+    long jobs() const { return usps_jobs(get()); }
+    Usps *get() const {
+        if (u_ == nullptr)
+            throw Error("usps: moved-from Scheduler");
+        return u_;
+    }
+
+  private:
+    Usps *u_;
+};
+
+class Tasks {
+  public:
+    explicit Tasks(const Config &cfg = Config(), long stack_size = 0) {
+        usps_config_t c = cfg.get();
+
+        if ((t_ = tk_create(&c, stack_size)) == nullptr)
+            throw Error("usps: cannot create the tasks");
+    }
+    ~Tasks() {
+        if (t_ != nullptr)
+            tk_destroy(t_);
+    }
+    Tasks(Tasks &&other) noexcept : t_(other.t_), fns_(std::move(other.fns_)) { other.t_ = nullptr; }
+    Tasks &operator=(Tasks &&other) noexcept {
+        if (this != &other) {
+            if (t_ != nullptr)
+                tk_destroy(t_);
+            t_ = other.t_;
+            fns_ = std::move(other.fns_);
+            other.t_ = nullptr;
+        }
+        return *this;
+    }
+    Tasks(const Tasks &) = delete;
+    Tasks &operator=(const Tasks &) = delete;
+
+    long spawn(std::function<void()> fn, int prio = 0) {
+        long id;
+
+        fns_.emplace_back(new std::function<void()>(std::move(fn)));
+        if ((id = tk_spawn(get(), &call, fns_.back().get(), prio)) == -1) {
+            fns_.pop_back();
+            throw Error("usps: cannot spawn a task");
+        }
+        return id;
+    }
+    long run_once() {
+        long left = tk_run_once(get());
+
+        if (left == -1)
+            throw Error("usps: cannot map a task stack");
+        return left;
+    }
+    void run() {
+        if (!tk_run(get()))
+            throw Error("usps: cannot map a task stack");
+    }
+    int state(long id) const { return tk_state(get(), id); }
+    static void yield() { tk_yield(); }
+    static void check() { tk_check(); }
+    ::Tasks *get() const {
+        if (t_ == nullptr)
+            throw Error("usps: moved-from Tasks");
+        return t_;
+    }
+
+  private:
+    static void call(void *fn) {
+        try {
+            (*static_cast<std::function<void()> *>(fn))();
+        } catch (...) {
+            std::terminate();
+        }
+    }
+
+    ::Tasks *t_;
+    std::vector<std::unique_ptr<std::function<void()>>> fns_;	/* owned until destroyed */
+};
+
+}  // namespace usps
+
+#endif /* _USPS_HPP_ */
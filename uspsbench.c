@@ -0,0 +1,514 @@
+/*
+ * micro-benchmarks for the scheduler's building blocks
+ *
+ * usage: ./uspsbench <benchmark> [iterations]
+ *
+ * each benchmark prints "<name> <iterations> <nsec per iteration>" lines,
+ * but for tickless, which prints "<name> <syscalls> <syscalls per second>",
+ * and soft, which prints throughput, turnaround and fairness lines
+ */
+
+#define _GNU_SOURCE	/* sched_setaffinity() */
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <sys/ptrace.h>
+#include <poll.h>
+#include <sched.h>
+#include "p1fxns.h"
+#include "tracer.h"
+#include "launch.h"
+#include "topo.h"
+#include "task.h"
+#include "stats.h"
+
+#define BENCH_USAGE "usage: ./uspsbench trace|launch|placement|tickless|switch|soft [iterations]\n"
+
+static void report(char *name, long iterations, uint64_t ns) {
+    char buf[25];
+    long per = (iterations > 0) ? (long)(ns * 10 / iterations) : 0L;
+
+    p1putstr(1, name);
+    p1putstr(1, " ");
+    p1ltoa(iterations, buf);
+    p1putstr(1, buf);
+    p1putstr(1, " ");
+    p1ltoa(per / 10, buf);
+    p1putstr(1, buf);
+    p1putstr(1, ".");
+    p1ltoa(per % 10, buf);
+    p1putstr(1, buf);
+    p1putstr(1, " ns/op\n");
+}
+
+/*
+ * cost of tr_record(): first into a ring large enough that nothing is
+ * flushed, then including the flushes to /dev/null a long run needs
+ */
+static int bench_trace(long n) {
+    uint64_t start;
+    long i;
+
+    if (!tr_open("/dev/null", n))
+        return 0;
+    start = tr_now();
+    for (i = 0; i < n; i++)
+        tr_record(TR_DISPATCH, i & 1023, 1, 0, 0);
+    report("trace_record", n, tr_now() - start);
+    tr_close();
+
+    if (!tr_open("/dev/null", 0L))
+        return 0;
+    start = tr_now();
+    for (i = 0; i < n; i++) {
+        tr_record(TR_DISPATCH, i & 1023, 1, 0, 0);
+        if ((i & 4095) == 0 && tr_pending() > DEFAULT_TRACE_EVENTS / 2)
+            tr_flush();
+    }
+    tr_flush();
+    report("trace_record_and_flush", n, tr_now() - start);
+    tr_close();
+
+    start = tr_now();
+    for (i = 0; i < n; i++)
+        tr_record(TR_DISPATCH, i & 1023, 1, 0, 0);
+    report("trace_disabled", n, tr_now() - start);
+    return 1;
+}
+
+/*
+ * launch throughput of each engine: `n' jobs of /bin/true are launched,
+ * started and reaped, while the benchmark holds (and has touched) 10 MB
+ * to 2 GB of memory, standing in for a scheduler with a large job table
+ * and trace ring; sizes that do not fit in half the free memory are skipped;
+ * the zygote is forked before any of that memory is allocated
+ */
+static int bench_launch(long n) {
+    static long sizes_mb[] = {10L, 100L, 500L, 2048L};
+    static char *names[] = {"fork", "clone", "spawn", "zygote"};
+    char *argv[] = {"/bin/true", NULL};
+    long avail_mb = sysconf(_SC_AVPHYS_PAGES) / (1048576L / sysconf(_SC_PAGESIZE));
+    ln_child_t *children = (ln_child_t *)malloc(n * sizeof(ln_child_t));
+    sigset_t usr1;
+    unsigned s;
+    int engine, exe;
+    long i;
+
+    if (children == NULL)
+        return 0;
+    sigemptyset(&usr1);
+    sigaddset(&usr1, SIGUSR1);
+    sigprocmask(SIG_BLOCK, &usr1, NULL);	/* see launch.h */
+    if (!ln_server_start())
+        return 0;
+    if ((exe = ln_resolve(argv[0])) == -1) {
+        p1perror(2, argv[0]);
+        return 0;
+    }
+    for (s = 0; s < sizeof(sizes_mb) / sizeof(sizes_mb[0]); s++) {
+        char *ballast;
+
+        if (sizes_mb[s] > avail_mb / 2)
+            break;
+        if ((ballast = (char *)malloc(sizes_mb[s] << 20)) == NULL)
+            break;
+        memset(ballast, 1, sizes_mb[s] << 20);
+        for (engine = LN_FORK; engine <= LN_ZYGOTE; engine++) {
+            char name[64], buf[25];
+            uint64_t start = tr_now(), ns;
+            long launched = 0;
+
+            for (i = 0; i < n; i++) {
+                if (!ln_launch(&children[launched], engine, exe, argv, NULL))
+                    break;
+                ln_start(&children[launched++]);
+            }
+            for (i = 0; i < launched; i++) {
+                while (waitpid(children[i].pid, NULL, 0) == -1)
+                    ;
+                ln_release(&children[i]);
+            }
+            ns = tr_now() - start;
+            p1strcpy(name, "launch_");
+            p1strcat(name, names[engine]);
+            p1strcat(name, "_");
+            p1ltoa(sizes_mb[s], buf);
+            p1strcat(name, buf);
+            p1strcat(name, "MB");
+            report(name, launched, ns);
+            p1ltoa((ns > 0) ? (long)(launched * 1000000000ULL / ns) : 0L, buf);
+            p1putstr(1, name);
+            p1putstr(1, " ");
+            p1putstr(1, buf);
+            p1putstr(1, " jobs/s\n");
+        }
+        free(ballast);
+    }
+    ln_server_stop();
+    ln_resolve_clear();
+    free(children);
+    return 1;
+}
+
+static void pin(int cpu) {
+    cpu_set_t set;
+
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    (void)sched_setaffinity(0, sizeof(set), &set);
+}
+
+/*
+ * one pass over the working set, a load per cache line
+ */
+static long sweep(char *ws, long size) {
+    long i, sum = 0;
+
+    for (i = 0; i < size; i += 64)
+        sum += ws[i];
+    return sum;
+}
+
+/*
+ * cost of moving a job with a large working set: `n' passes over 256 MB
+ * (or a quarter of the free memory, if less), first-touched on the first
+ * allowed CPU, while staying pinned there, and while alternating with a
+ * CPU on the same core (SMT sibling), another core sharing the last-level
+ * cache, another cache group on the same node, and another node; kinds of
+ * CPU the machine lacks are skipped
+ */
+static int bench_placement(long n) {
+    static topo_cpu_t cpus[TOPO_MAX_CPUS];
+    static char *kinds[] = {"pinned", "smt", "llc", "node_llc", "remote_node"};
+    long avail_mb = sysconf(_SC_AVPHYS_PAGES) / (1048576L / sysconf(_SC_PAGESIZE));
+    long size = ((avail_mb / 4 < 256L) ? avail_mb / 4 : 256L) << 20;
+    volatile long sink = 0;
+    cpu_set_t allowed;
+    int ncpus, i, j, kind;
+    char *ws;
+
+    ncpus = topo_read(cpus, TOPO_MAX_CPUS);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+        for (i = j = 0; i < ncpus; i++)
+            if (cpus[i].cpu < CPU_SETSIZE && CPU_ISSET(cpus[i].cpu, &allowed))
+                cpus[j++] = cpus[i];
+        ncpus = (j > 0) ? j : ncpus;
+    }
+    if (ncpus < 2) {
+        p1putstr(1, "placement skipped: needs 2 CPUs\n");
+        return 1;
+    }
+    if ((ws = (char *)malloc(size)) == NULL)
+        return 0;
+    pin(cpus[0].cpu);
+    memset(ws, 1, size);
+    for (kind = 0; kind < 5; kind++) {
+        char name[64], buf[25];
+        uint64_t start;
+        int other = -1;
+        long pass;
+
+        for (i = 1; kind > 0 && other == -1 && i < ncpus; i++) {
+            topo_cpu_t *c = &cpus[i];
+
+            if ((kind == 1 && c->core == cpus[0].core)
+                || (kind == 2 && c->core != cpus[0].core && c->llc == cpus[0].llc)
+                || (kind == 3 && c->node == cpus[0].node && c->llc != cpus[0].llc)
+                || (kind == 4 && c->node != cpus[0].node))
+                other = c->cpu;
+        }
+        if (kind > 0 && other == -1)
+            continue;
+        sink += sweep(ws, size);	/* warm up on the home CPU */
+        start = tr_now();
+        for (pass = 0; pass < n; pass++) {
+            if (kind > 0)
+                pin((pass & 1) ? cpus[0].cpu : other);
+            sink += sweep(ws, size);
+        }
+        pin(cpus[0].cpu);
+        p1strcpy(name, "placement_");
+        p1strcat(name, kinds[kind]);
+        p1strcat(name, "_");
+        p1ltoa(size >> 20, buf);
+        p1strcat(name, buf);
+        p1strcat(name, "MB");
+        report(name, n, tr_now() - start);
+    }
+    free(ws);
+    return 1;
+}
+
+/*
+ * runs ./uspsv3 with `args' under ptrace, and returns the number of system
+ * calls it made (its jobs are not traced), or -1
+ */
+static long count_syscalls(char *args[]) {
+    long calls = 0;
+    pid_t pid;
+    int status;
+
+    if ((pid = fork()) == -1)
+        return -1L;
+    if (pid == 0) {
+        int null = open("/dev/null", O_WRONLY);
+
+        dup2(null, 1);
+        dup2(null, 2);
+        ptrace(PTRACE_TRACEME, 0, NULL, NULL);
+        execv(args[0], args);
+        _exit(127);
+    }
+    if (waitpid(pid, &status, 0) == -1 || !WIFSTOPPED(status))	/* at the exec */
+        return -1L;
+    ptrace(PTRACE_SETOPTIONS, pid, NULL, (void *)(long)(PTRACE_O_TRACESYSGOOD | PTRACE_O_EXITKILL));
+    ptrace(PTRACE_SYSCALL, pid, NULL, NULL);
+    while (waitpid(pid, &status, 0) != -1 && WIFSTOPPED(status)) {
+        int sig = WSTOPSIG(status);
+
+        if (sig == (SIGTRAP | 0x80)) {		/* entry or exit */
+            calls++;
+            sig = 0;
+        }
+        ptrace(PTRACE_SYSCALL, pid, NULL, (void *)(long)sig);
+    }
+    return (WIFEXITED(status) && WEXITSTATUS(status) == 1) ? calls / 2 : -1L;
+}
+
+/*
+ * system calls per second the scheduler makes running one job, `n'
+ * seconds of sleep, with a 20 ms quantum: with a periodic timer it wakes
+ * up every quantum to stop and continue the job, with --tickless it does
+ * not, there being nothing to switch to
+ */
+static int bench_tickless(long n) {
+    static char *names[] = {"one_job_periodic", "one_job_tickless"};
+    char file[] = "/tmp/uspsbenchXXXXXX", buf[25];
+    char *args[] = {"./uspsv3", "--quantum=20", file, NULL, NULL};
+    int fd, i;
+
+    if ((fd = mkstemp(file)) == -1) {
+        p1perror(2, "mkstemp");
+        return 0;
+    }
+    p1putstr(fd, "sleep ");
+    p1ltoa(n, buf);
+    p1putstr(fd, buf);
+    p1putstr(fd, "\n");
+    close(fd);
+    for (i = 0; i < 2; i++) {
+        uint64_t start = tr_now(), ns;
+        long calls;
+
+        if (i == 1) {
+            args[2] = "--tickless";
+            args[3] = file;
+        }
+        if ((calls = count_syscalls(args)) == -1) {
+            p1putstr(2, "uspsbench: ./uspsv3 failed, or could not be traced\n");
+            unlink(file);
+            return 0;
+        }
+        ns = tr_now() - start;
+        p1putstr(1, names[i]);
+        p1putstr(1, " ");
+        p1ltoa(calls, buf);
+        p1putstr(1, buf);
+        p1putstr(1, " ");
+        p1ltoa((ns > 0) ? (long)(calls * 1000000000ULL / ns) : 0L, buf);
+        p1putstr(1, buf);
+        p1putstr(1, " syscalls/s\n");
+    }
+    unlink(file);
+    return 1;
+}
+
+static long yields;
+
+static void ping(void *arg) {
+    long i, n = *(long *)arg;
+
+    for (i = 0; i < n; i++) {
+        yields++;
+        tk_yield();
+    }
+}
+
+static void nothing(void *arg) {
+    (void)arg;
+}
+
+/*
+ * cost of a switch between two in-process tasks (one tk_yield(), through
+ * the scheduler to the other task), of running a task that does nothing
+ * (stack from the pool included), and of a switch between two processes by
+ * SIGSTOP and SIGCONT, waiting for each to take effect, as uspsv3 does
+ */
+static int bench_switch(long n) {
+    usps_config_t cfg;
+    Tasks *t;
+    uint64_t start;
+    pid_t pids[2];
+    long half = n / 2, i;
+    int status;
+
+    usps_defaults(&cfg);
+    cfg.quantum_ms = 1000;
+    if ((t = tk_create(&cfg, 0L)) == NULL)
+        return 0;
+    yields = 0;
+    tk_spawn(t, &ping, &half, 0);
+    tk_spawn(t, &ping, &half, 0);
+    start = tr_now();
+    if (!tk_run(t))
+        return 0;
+    report("task_switch", yields, tr_now() - start);
+    tk_destroy(t);
+
+    if ((t = tk_create(&cfg, 0L)) == NULL)
+        return 0;
+    for (i = 0; i < n; i++)
+        if (tk_spawn(t, &nothing, NULL, 0) == -1)
+            return 0;
+    start = tr_now();
+    if (!tk_run(t))
+        return 0;
+    report("task_run_empty", n, tr_now() - start);
+    tk_destroy(t);
+
+    for (i = 0; i < 2; i++) {
+        if ((pids[i] = fork()) == -1)
+            return 0;
+        if (pids[i] == 0) {
+            for (;;)
+                pause();
+        }
+    }
+    kill(pids[1], SIGSTOP);	/* one runs, the other is stopped */
+    waitpid(pids[1], &status, WUNTRACED);
+    start = tr_now();
+    for (i = 0; i < n; i++) {
+        pid_t from = pids[i & 1], to = pids[(i + 1) & 1];
+
+        kill(from, SIGSTOP);
+        waitpid(from, &status, WUNTRACED);
+        kill(to, SIGCONT);
+        waitpid(to, &status, WCONTINUED);
+    }
+    report("process_switch_sigstop_sigcont", n, tr_now() - start);
+    for (i = 0; i < 2; i++) {
+        kill(pids[i], SIGKILL);
+        waitpid(pids[i], &status, 0);
+    }
+    return 1;
+}
+
+/*
+ * `n' jobs that each sleep 20 ms and then compute for about 10 ms, twenty
+ * times over, round robin with a 20 ms quantum and one slot per CPU, under
+ * each backend: stopped jobs leave a CPU idle while the job that holds it
+ * sleeps, demoted ones use it; USPS_CGROUP runs only if USPS_CGROUP is set
+ *
+ * turnaround is seen at quantum granularity; fairness is Jain's index of
+ * the jobs' rates, one over their turnaround, as they all do the same work
+ */
+static int bench_soft(long n) {
+    static char *names[] = {"soft_signal", "soft_nice", "soft_idle", "soft_cgroup"};
+    static char *args[] = {"/bin/sh", "-c",
+        "i=0; while [ $i -lt 20 ]; do sleep 0.02; j=0; "
+        "while [ $j -lt 5000 ]; do j=$((j+1)); done; i=$((i+1)); done", NULL};
+    uint64_t *ended = (uint64_t *)malloc(n * sizeof(uint64_t));
+    usps_config_t cfg;
+    int backend;
+    long i;
+
+    if (ended == NULL || n <= 0)
+        return 0;
+    usps_defaults(&cfg);
+    cfg.quantum_ms = 20;
+    cfg.slots = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    for (backend = USPS_SIGNAL; backend <= USPS_CGROUP; backend++) {
+        Series turnaround, rates;
+        char name[64];
+        struct pollfd pfd;
+        uint64_t start, ns;
+        Usps *u;
+
+        if (backend == USPS_CGROUP && getenv("USPS_CGROUP") == NULL)
+            break;
+        cfg.backend = backend;
+        if ((u = usps_create(&cfg)) == NULL)
+            return 0;
+        start = tr_now();
+        for (i = 0; i < n; i++) {
+            ended[i] = 0;
+            if (usps_submit(u, args, 0) == -1) {
+                usps_destroy(u);
+                return 0;
+            }
+        }
+        pfd.fd = usps_fd(u);
+        pfd.events = POLLIN;
+        while (usps_run_once(u) > 0) {
+            for (i = 0; i < n; i++)
+                if (ended[i] == 0 && usps_state(u, i) == USPS_DONE)
+                    ended[i] = tr_now();
+            (void)poll(&pfd, 1, -1);
+        }
+        ns = tr_now() - start;
+        p1strcpy(name, names[backend]);
+        p1strcat(name, "_turnaround");
+        st_init(&turnaround, name);
+        st_init(&rates, "");
+        for (i = 0; i < n; i++) {
+            long usec = (long)(((ended[i] != 0) ? ended[i] : start + ns) - start) / 1000L;
+
+            st_add(&turnaround, usec);
+            st_add(&rates, 1000000000000L / (usec + 1));
+        }
+        p1bputstr(1, names[backend]);
+        p1bputstr(1, " ");
+        p1bputlong(1, n);
+        p1bputstr(1, " ");
+        p1bputlong(1, (ns > 0) ? (long)(n * 60000000000ULL / ns) : 0L);
+        p1bputstr(1, " jobs/min\n");
+        st_print(1, &turnaround);
+        p1strcpy(name, names[backend]);
+        p1strcat(name, "_jain_fairness");
+        st_putjain(1, name, &rates);
+        p1bflush(1);
+        st_free(&turnaround);
+        st_free(&rates);
+        usps_destroy(u);
+    }
+    free(ended);
+    return 1;
+}
+
+int main(int argc, char *argv[]) {
+    long n = 10000000L;
+
+    if (argc < 2 || argc > 3) {
+        p1putstr(2, BENCH_USAGE);
+        return 1;
+    }
+    if (argc == 3)
+        n = p1atoi(argv[2]);
+    if (p1strneq(argv[1], "trace", 6))
+        return !bench_trace(n);
+    if (p1strneq(argv[1], "launch", 7))
+        return !bench_launch((argc == 3) ? n : 1000L);
+    if (p1strneq(argv[1], "placement", 10))
+        return !bench_placement((argc == 3) ? n : 20L);
+    if (p1strneq(argv[1], "switch", 7))
+        return !bench_switch((argc == 3) ? n : 100000L);
+    if (p1strneq(argv[1], "soft", 5))
+        return !bench_soft((argc == 3) ? n : 8L * sysconf(_SC_NPROCESSORS_ONLN));
+    if (p1strneq(argv[1], "tickless", 9))
+        return !bench_tickless((argc == 3) ? n : 5L);
+    p1putstr(2, BENCH_USAGE);
+    return 1;
+}
@@ -0,0 +1,96 @@
+/*
+ * command-line client for the uspsv3 daemon's control socket
+ *
+ * usage: ./uspsctl <socket> [command [args...]]
+ *
+ * with a command, sends that one command; without, sends every line of
+ * standard input as one batched request, e.g.
+ *
+ *	sed 's/^/submit /' workload.txt | ./uspsctl /tmp/usps.ctl
+ *
+ * the daemon's replies are copied to standard output; the exit status is 1
+ * if any reply is an error
+ */
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <string.h>
+#include <unistd.h>
+#include "p1fxns.h"
+
+#define CTL_USAGE "usage: ./uspsctl <socket> [command [args...]]\n"
+#define CTL_IO_SIZE 65536
+
+static int write_all(int fd, char *buf, int n) {
+    while (n > 0) {
+        int w = write(fd, buf, n);
+
+        if (w <= 0)
+            return 0;
+        buf += w;
+        n -= w;
+    }
+    return 1;
+}
+
+int main(int argc, char *argv[]) {
+    struct sockaddr_un addr;
+    char buf[CTL_IO_SIZE], head[5];	/* the start of the current reply line */
+    int sock, n, i;
+    int errors = 0, len = 0;
+
+    if (argc < 2) {
+        p1putstr(2, CTL_USAGE);
+        return 2;
+    }
+    if (p1strlen(argv[1]) >= (int)sizeof(addr.sun_path)) {
+        p1putstr(2, "socket path is too long\n");
+        return 2;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    p1strcpy(addr.sun_path, argv[1]);
+    if ((sock = socket(AF_UNIX, SOCK_STREAM, 0)) == -1
+        || connect(sock, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
+        p1perror(2, "cannot connect to the daemon");
+        return 2;
+    }
+
+    if (argc > 2) {
+        for (i = 2; i < argc; i++) {
+            /* the daemon splits on blanks, honouring quotes as p1getword() does */
+            char *q = (p1strchr(argv[i], '\'') == -1) ? "'" : "\"";
+            int quote = p1strchr(argv[i], ' ') != -1 || p1strchr(argv[i], '\t') != -1;
+
+            if ((quote && !write_all(sock, q, 1))
+                || !write_all(sock, argv[i], p1strlen(argv[i]))
+                || (quote && !write_all(sock, q, 1))
+                || !write_all(sock, (i + 1 < argc) ? " " : "\n", 1))
+                break;
+        }
+    } else {
+        while ((n = read(0, buf, CTL_IO_SIZE)) > 0) {
+            if (!write_all(sock, buf, n))
+                break;
+        }
+    }
+    shutdown(sock, SHUT_WR);	/* end of request */
+
+    /* a line may be split across reads, so it is judged once it has ended */
+    while ((n = read(sock, buf, CTL_IO_SIZE)) > 0) {
+        for (i = 0; i < n; i++) {
+            if (buf[i] == '\n') {
+                if (len == 5 && p1strneq(head, "error", 5))
+                    errors = 1;
+                len = 0;
+            } else if (len < 5)
+                head[len++] = buf[i];
+        }
+        write_all(1, buf, n);
+    }
+    if (len == 5 && p1strneq(head, "error", 5))
+        errors = 1;	/* the last line had no newline */
+    close(sock);
+    return errors;
+}
@@ -22,10 +22,14 @@
  * this cycle continues until every process is done executing their program.
  */
 
+#define _GNU_SOURCE/*sched_setaffinity()*/
 #include <sys/types.h>
 #include <sys/uio.h>
 #include <sys/stat.h>
 #include <sys/time.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <sys/prctl.h>
 #include <time.h>
 #include <stdlib.h>
 #include <fcntl.h>
@@ -34,304 +38,2194 @@
 #include <string.h>
 #include <stdio.h>
 #include <signal.h>
+#include <poll.h>
+#include <sched.h>
 #include "p1fxns.h"
-#include "bqueue.h"
+#include "policy.h"
+#include "sim.h"
+#include "tracer.h"
+#include "metrics.h"
+#include "control.h"
+#include "launch.h"
+#include "psi.h"
+#include "topo.h"
+#include "dag.h"
+#include "workload.h"
+#include "hotpath.h"
+#include "stats.h"
+#include "jobtab.h"
 
-#define USAGE "usage: ./uspsv? [--quantum=<msec>] [workload_file]\n"
-#define LINE_SIZE 128
+#define USAGE "usage: ./uspsv3 [--quantum=<msec>] [--launch=fork|clone|spawn|zygote] [--max-live=<n>] [--psi=<triggers>] [--cpus=<n>] [--gang] [--subreaper] [--cpu-budget=<msec>] [--wall-budget=<msec>] [--grace=<msec>] [--tickless] [--simulate] [--trace=<file>] [--metrics=<socket>] [--daemon=<socket>] [workload_file|image]\n"
+#define CTL_LINE_MAX 4096/*longest control request line accepted*/
 
-int child_received = 0; /*flag to set when child received signal*/
+/*job states*/
+#define JOB_READY 0/*on the ready queue*/
+#define JOB_RUNNING 1/*holding a CPU slot*/
+#define JOB_PAUSED 2/*stopped by a control request, off the ready queue*/
+#define JOB_DONE 3/*terminated and reaped*/
+#define JOB_WAITING 4/*not launched yet, waiting for a slot under --max-live*/
+#define JOB_BLOCKED 5/*not launched yet, waiting for the jobs it runs after to succeed*/
+
+/*states of a job's process, as waitid() reports them; the job states above are the scheduler's view*/
+#define PS_NOT_STARTED 0/*launched, its start gate not opened yet*/
+#define PS_RUNNING 1
+#define PS_STOPPED 2
+#define PS_EXITED 3
+#define PS_SIGNALED 4
+
+#define BUDGET_CPU 1
+#define BUDGET_WALL 2
+
+int launch_engine = LN_FORK;/*set by --launch=<engine>*/
 pid_t ppid; /*The process ID of the parent process is stored here*/
 int quantum = -1;/*environment variable or command line arguments get saved in here*/
-int active_processes;
+int active_processes;/*jobs launched and not yet reaped*/
+int max_live = 0;/*set by --max-live=<n>: most jobs launched and not yet reaped, 0 for no limit*/
+int waiting_jobs = 0;/*jobs in JOB_WAITING*/
+int blocked_jobs = 0;/*jobs in JOB_BLOCKED*/
+int next_admit = 0;/*no job before this index is waiting*/
+int psi_on = 0;/*set by --psi=<triggers>: the pressure governor is active*/
+int parked_jobs = 0;/*jobs the governor keeps off the CPU*/
+int shutting_down = 0;/*daemon: exit once every job has been reaped*/
+int subreaper = 0;/*set by --subreaper: orphaned descendants of the jobs are adopted, and a job is done once its process group is empty*/
+int lingering_jobs = 0;/*--subreaper: jobs whose process has exited while others of its group have not*/
+long orphans_reaped = 0;/*--subreaper: adopted descendants reaped, attributed to a job or not*/
+long orphans_unattributed = 0;/*those that had left their job's process group*/
+ln_setup_t own_group;/*--subreaper: the setup of jobs that have none of their own*/
+long default_cpu_budget = 0;/*set by --cpu-budget=<msec>: for jobs without cpu_budget=, 0 for none*/
+long default_wall_budget = 0;/*set by --wall-budget=<msec>: for jobs without wall_budget=, 0 for none*/
+long grace_ms = 5000;/*set by --grace=<msec>: from SIGTERM to SIGKILL for a job over budget*/
+int tickless = 0;/*set by --tickless: no time slices while every running job has a slot of its own*/
+int timer_armed = 0;
+uint64_t workload_at = 0;/*when the workload was added; the arrival time of its jobs*/
+long context_switches = 0;/*jobs stopped at the end of a slice, to give the slot to the next*/
+uint64_t busy_since;/*when some slot last stopped being idle*/
+long busy_ns = 0;/*time at least one slot held a job*/
 struct timespec ms20 = {0, 20000000}; /* 20 ms */ 
+sigset_t sched_signals;/*SIGALRM and SIGCHLD, blocked while the main loop changes scheduler state*/
 
 typedef struct args_q args_t;/*linked list for arguments*/
 typedef struct proc proc_t;/*this struct will be used to keep track of child process and its status*/
-BQueue *ready_q = NULL;/*ready queue*/
-proc_t *ID;/*ID of the running process*/
+typedef struct slot slot_t;/*a CPU the scheduler hands out time slices on*/
+typedef struct gang gang_t;/*jobs that cooperate, declared with gang=<name>*/
+Policy *ready_q[TOPO_MAX_NODES];/*ready queue of each NUMA node, shared policy code with the simulator*/
+int num_nodes = 1;
+int node_slots[TOPO_MAX_NODES] = {1};/*slots on each node*/
+int node_load[TOPO_MAX_NODES];/*jobs placed on each node and not yet reaped*/
+slot_t *slots;/*num_slots of them, in the order they are filled*/
+int num_slots = 1;
+int placing = 0;/*set by --cpus=<n>: jobs are pinned to the CPUs of the slots*/
+gang_t *gangs;
+int num_gangs;
+int gang_cap;
+int gang_mode = 0;/*set by --gang: the members of a gang are dispatched and preempted together*/
+proc_t *pending_gang = NULL;/*--gang: stands for a gang taken off a ready queue, waiting for enough idle slots*/
+Dag *dag = NULL;/*dependencies between the jobs of the workload, NULL if there are none*/
+long *dag_stack;/*room to skip every job of the workload, see release_dependents()*/
+args_t *array_cursor = NULL;/*the job array whose elements are admitted next*/
+long array_next;/*the index of its next element*/
+long array_left = 0;/*elements of the workload's job arrays not yet in the job table*/
+JobTab *job_tab;/*every job, and the pid of every job launched and not yet done, see jobtab.h*/
+proc_t **jobs;/*the job table itself, in submission order; a job's index is its id*/
+int num_jobs;
+int job_cap;/*jobs the ready queues have room for*/
+args_t *submitted = NULL;/*daemon: commands of the jobs submitted at runtime*/
+wl_image_t image;/*the compiled workload image, base is NULL if the workload is text*/
+args_t *image_args;/*the image's workload list, in one block*/
+char **image_argv;/*its argument lists, in one block of pointers into the image*/
+proc_t *job_slab;/*the workload's jobs, in one block, see add_workload()*/
+int slab_next;
+int slab_size;
 
 struct args_q{
 	args_t *next;
 	char **args;
+	int exe;/*the command resolved by ln_resolve(), -1 if it could not be*/
+	char *gang;/*name given by gang=<name>, NULL if none*/
+	char *name;/*name given by name=<name>, NULL if none*/
+	char *after;/*names given by after=<name>[,<name>...], NULL if none*/
+	long first;/*[<first>-<last>]: a job array, expanded as it is admitted; first > last if not*/
+	long last;
+	long cpu_budget;/*msec given by cpu_budget=<msec>, 0 if none*/
+	long wall_budget;/*msec given by wall_budget=<msec>, 0 if none*/
+};
+
+struct gang{
+	char *name;
+	int *members;/*job ids, in submission order*/
+	int count;
+	int cap;
+	int queued;/*--gang: a ready member stands for the gang on a ready queue, or is pending_gang*/
+	int next;/*--gang: member to start from when there are fewer slots than members*/
+	uint64_t since;/*when the times below were last brought up to date, 0 if never*/
+	long busy_ns;/*time at least one member held a slot*/
+	long together_ns;/*time every runnable member held a slot at once*/
+};
+
+struct slot{
+	topo_cpu_t where;/*cpu is -1 when not placing*/
+	proc_t *job;/*the running job, NULL if the slot is idle*/
+	uint64_t dispatched_at;/*when it was given the slot, for per-job CPU time and slice jitter*/
 };
 
 struct proc{
+	int id;/*index in the job table, also the trace job id*/
 	pid_t pid;
-	int status;/*1: alive, 0: not running/terminated*/
+	int status;/*1: started, 0: waiting for its first dispatch*/
+	int state;/*JOB_READY ... JOB_WAITING*/
+	int prio;/*lower runs first*/
+	int weight;/*consecutive quanta the job gets per turn*/
+	int ticks;/*quanta left in the current turn*/
+	long deadline;/*msec on the monotonic clock, 0 if none*/
+	int cancelled;/*killed by a control request*/
+	int skipped;/*never launched, as a job it runs after failed*/
+	long unmet;/*jobs it runs after that have not succeeded yet*/
+	long rank;/*length of the longest chain of jobs that run after it*/
+	long index;/*its index if it is an element of a job array, -1 if not*/
+	int parked;/*paused by the pressure governor*/
+	int in_slab;/*part of job_slab rather than allocated on its own*/
+	int pstate;/*PS_NOT_STARTED ... PS_SIGNALED*/
+	int held;/*stopped from outside the scheduler while it held a slot; paused until continued*/
+	int exec_errno;/*why it could not set itself up or exec its command, 0 if it could*/
+	int lingering;/*--subreaper: its process has exited, others of its process group have not*/
+	long cpu_budget;/*msec of CPU it may use, 0 for no limit*/
+	long wall_budget;/*msec it may take from its first dispatch, 0 for no limit*/
+	uint64_t started_at;/*its first dispatch*/
+	clockid_t cpu_clock;/*its process's CPU-time clock*/
+	int over_budget;/*BUDGET_CPU or BUDGET_WALL once it has exceeded one, 0 before*/
+	int budget_sig;/*the last signal it was sent for it: SIGTERM, then SIGKILL*/
+	uint64_t term_at;/*when it was sent SIGTERM*/
+	long orphans;/*--subreaper: its descendants adopted and reaped by the scheduler*/
+	long orphan_ns;/*their CPU time*/
+	int wait_status;/*from waitpid, once JOB_DONE*/
+	uint64_t arrived_at;/*when it was submitted, or its workload added*/
+	uint64_t finished_at;
+	long cpu_ns;/*total time this job has held a CPU slot*/
+	int gang;/*index in gangs[], -1 if none*/
+	int slot;/*index in slots[] while JOB_RUNNING*/
+	int last_slot;/*the slot it last ran in, -1 if it has not run*/
+	int home;/*node whose ready queue it goes on, -1 until it is first made ready*/
+	int migrations;/*times it ran on another node than the time before*/
+	long node_ns[TOPO_MAX_NODES];/*CPU time on each node*/
+	char **args;/*the command; owned by the workload or submission list*/
+	int exe;/*args[0] resolved by ln_resolve()*/
+	ln_setup_t *setup;/*per-job process setup, NULL to inherit everything*/
+	ln_child_t ln;/*how the job was launched*/
 };
 
+/*
+returns the index of the job running in process `pid', -1 if there is none
+with --subreaper, a job's process leads its process group, so this also finds
+the job of the process group `pid'
+only jobs that are not done are found: their pids may have been reused since
+*/
+int job_of(pid_t pid){
+	return (job_tab == NULL) ? -1 : (int)jt_find(job_tab, pid);
+}
+
+/*
+sends `sig' to a job; with --subreaper, to every process of its group, so that
+its descendants run only in its time slices
+*/
+void signal_job(proc_t *job, int sig){
+	HP_BEGIN(mark);
+	kill(subreaper ? -job->pid : job->pid, sig);
+	HP_SYSCALLS(1);
+	if(sig == SIGSTOP || sig == SIGCONT){
+		HP_END((sig == SIGSTOP) ? HP_STOP : HP_CONT, mark);
+	}
+}
+
+/*
+with --subreaper, returns 1 if some process of the job's group, a zombie included,
+has not been reaped; returns 0 otherwise
+*/
+int group_alive(proc_t *job){
+	HP_SYSCALLS(subreaper);
+	return subreaper && (kill(-job->pid, 0) == 0 || errno == EPERM);
+}
+
+/*
+brings the co-scheduling times of the job's gang up to date; called before any
+of its members is dispatched, preempted, queued or taken off the CPU for good
+*/
+void gang_account(proc_t *job){
+	gang_t *g;
+	uint64_t now;
+	int i, running = 0, runnable = 0;
+	if(job->gang == -1)
+		return;
+	g = &gangs[job->gang];
+	now = tr_now();
+	for(i=0; i<g->count; i++){
+		int state = jobs[g->members[i]]->state;
+		running += (state == JOB_RUNNING);
+		runnable += (state == JOB_RUNNING || state == JOB_READY);
+	}
+	if(g->since != 0 && running > 0){
+		g->busy_ns += now - g->since;
+		if(running == runnable)
+			g->together_ns += now - g->since;
+	}
+	g->since = now;
+}
+
+int set_up_timer();
+void stop_timer();
+
+/*
+puts a job on its node's ready queue; there is always room, see add_job()
+a job is placed on a node the first time, the one with the fewest jobs per slot
+with --gang, only one ready member of a gang is queued, and stands for all of them
+with --tickless, time slices start again if they had stopped
+*/
+void make_ready(proc_t *job){
+	if(tickless && !timer_armed)
+		(void)set_up_timer();
+	gang_account(job);
+	if(job->home == -1){
+		int n, best = 0;
+		for(n=1; n<num_nodes; n++){
+			if(node_slots[n] > 0 && (node_slots[best] == 0
+			   || node_load[n]*node_slots[best] < node_load[best]*node_slots[n]))
+				best = n;
+		}
+		job->home = best;
+		node_load[best]++;
+	}
+	job->state = JOB_READY;
+	if(gang_mode && job->gang != -1){
+		if(gangs[job->gang].queued)
+			return;
+		gangs[job->gang].queued = 1;
+	}
+	{
+		HP_BEGIN(mark);
+		pol_ready_ranked(ready_q[job->home], job, job->prio, job->deadline, job->rank);
+		HP_END(HP_QUEUE, mark);
+	}
+}
+
+/*
+takes a ready job off its ready queue; with --gang, if it stood for its gang,
+another ready member takes its place
+*/
+void unqueue(proc_t *job){
+	gang_t *g;
+	int i, removed;
+	HP_BEGIN(mark);
+	removed = pol_remove(ready_q[job->home], job);
+	HP_END(HP_QUEUE, mark);
+	if(!removed || !gang_mode || job->gang == -1)
+		return;
+	g = &gangs[job->gang];
+	g->queued = 0;
+	for(i=0; i<g->count; i++){
+		proc_t *m = jobs[g->members[i]];
+		if(m != job && m->state == JOB_READY){
+			make_ready(m);
+			break;
+		}
+	}
+}
+
+/*
+returns the number of jobs on the ready queues
+*/
+long ready_count(){
+	long n = 0;
+	int i;
+	for(i=0; i<num_nodes; i++)
+		n += pol_size(ready_q[i]);
+	return n;
+}
+
+/*
+takes slot `s' from its job and accounts for the time the job held it
+returns that time
+*/
+uint64_t vacate(slot_t *s){
+	uint64_t ran;
+	gang_account(s->job);
+	ran = tr_now() - s->dispatched_at;
+	s->job->cpu_ns += ran;
+	s->job->node_ns[s->where.node] += ran;
+	mx_job_stop(s->job->id, ran);
+	s->job = NULL;
+	if(--mx.running == 0)
+		busy_ns += tr_now() - busy_since;
+	return ran;
+}
+
+/*
+checks a job's budgets at the end of one of its slices, against the CPU time its
+process has used (with --subreaper, plus that of the orphans reaped so far) and the
+time since its first dispatch; a job over budget is sent SIGTERM, which it gets
+when it next runs, and SIGKILL at the first slice end grace_ms later
+*/
+void check_budget(proc_t *job, uint64_t now){
+	struct timespec ts;
+	if(job->budget_sig == SIGTERM && now - job->term_at >= (uint64_t)grace_ms * 1000000ULL){
+		signal_job(job, SIGKILL);
+		job->budget_sig = SIGKILL;
+	}
+	if(job->budget_sig != 0)
+		return;
+	if(job->cpu_budget > 0 && clock_gettime(job->cpu_clock, &ts) == 0
+	   && ts.tv_sec * 1000L + ts.tv_nsec / 1000000L + job->orphan_ns / 1000000L > job->cpu_budget)
+		job->over_budget = BUDGET_CPU;
+	else if(job->wall_budget > 0 && (long)((now - job->started_at) / 1000000ULL) > job->wall_budget)
+		job->over_budget = BUDGET_WALL;
+	else
+		return;
+	signal_job(job, SIGTERM);
+	job->budget_sig = SIGTERM;
+	job->term_at = now;
+}
+
+/*
+stops the job running in slot `s' and puts it back on the ready queue
+*/
+void preempt_slot(slot_t *s){
+	proc_t *job = s->job;
+	uint64_t ran;
+	signal_job(job, SIGSTOP);
+	context_switches++;
+	tr_record(TR_PREEMPT, job->id, job->pid, s - slots, 0);
+	ran = vacate(s);
+	mx_slice(ran, (long)quantum * job->weight * 1000000L);
+	if(job->cpu_budget > 0 || job->wall_budget > 0)
+		check_budget(job, s->dispatched_at + ran);
+	make_ready(job);
+}
+
+/*
+runs `job' in slot `i'; if it has not started, start it; otherwise continue
+*/
+void run_in(int i, proc_t *job){
+	slot_t *s = &slots[i];
+	gang_account(job);
+	if(job->last_slot != -1 && slots[job->last_slot].where.node != s->where.node)
+		job->migrations++;
+	if(placing && (job->last_slot == -1 || slots[job->last_slot].where.cpu != s->where.cpu)
+	   && (job->setup == NULL || job->setup->cpu < 0)){
+		/*best effort: the job may have narrowed its own mask; threads it created keep theirs*/
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(s->where.cpu, &set);
+		(void)sched_setaffinity(job->pid, sizeof(set), &set);
+		HP_SYSCALLS(1);
+	}
+	job->state = JOB_RUNNING;
+	job->ticks = job->weight;
+	job->slot = job->last_slot = i;
+	s->job = job;
+	if(job->status == 1)
+		signal_job(job, SIGCONT);
+	else{
+		job->status = 1;
+		job->pstate = PS_RUNNING;
+		job->started_at = tr_now();
+		HP_BEGIN(mark);
+		ln_start(&job->ln);/*open the start gate*/
+		HP_SYSCALLS(1);
+		HP_END(HP_CONT, mark);
+	}
+	tr_record(TR_DISPATCH, job->id, job->pid, i, 0);
+	s->dispatched_at = tr_now();
+	mx_job_run(job->id, s->where.node, s->dispatched_at);
+	mx.dispatches++;
+	if(mx.running++ == 0)
+		busy_since = s->dispatched_at;
+}
+
+/*
+takes the next job for a slot on `node' off its ready queue; if there is none,
+takes one from the node with the longest queue, and places it on `node' from then on
+returns 1 if there was a job, 0 if not
+*/
+int take_job(int node, proc_t **job){
+	int n, from = -1, taken;
+	HP_BEGIN(mark);
+	taken = pol_next(ready_q[node], (void **)job);
+	HP_END(HP_QUEUE, mark);
+	if(taken)
+		return 1;
+	for(n=0; n<num_nodes; n++){
+		if(pol_size(ready_q[n]) > 0 && (from == -1 || pol_size(ready_q[n]) > pol_size(ready_q[from])))
+			from = n;
+	}
+	if(from == -1)
+		return 0;
+	{
+		HP_BEGIN(steal);
+		taken = pol_next(ready_q[from], (void **)job);
+		HP_END(HP_QUEUE, steal);
+	}
+	if(!taken)
+		return 0;
+	node_load[from]--;
+	node_load[node]++;
+	(*job)->home = node;
+	return 1;
+}
+
+/*
+--gang: preempts every member of gang `g' that holds a slot
+*/
+void preempt_gang(int g){
+	int i;
+	for(i=0; i<gangs[g].count; i++){
+		proc_t *m = jobs[gangs[g].members[i]];
+		if(m->state == JOB_RUNNING)
+			preempt_slot(&slots[m->slot]);
+	}
+}
+
+/*
+--gang: runs the ready members of the gang `rep' stands for all at once, each in
+the slot it last ran in if that is idle, else in the first idle one; a gang with
+more ready members than there are slots runs as many as fit, and the rest are
+queued to run next time round
+returns 1 if the gang ran, 0 if it must wait for enough idle slots
+*/
+int run_gang(proc_t *rep){
+	gang_t *g = &gangs[rep->gang];
+	int ready = 0, idle = 0, i, k;
+	for(i=0; i<g->count; i++)
+		ready += (jobs[g->members[i]]->state == JOB_READY);
+	for(i=0; i<num_slots; i++)
+		idle += (slots[i].job == NULL);
+	if(ready > num_slots)
+		ready = num_slots;
+	if(idle < ready)
+		return 0;
+	pending_gang = NULL;
+	g->queued = 0;
+	for(k=0; k<g->count && ready > 0; k++){
+		proc_t *m = jobs[g->members[(g->next + k) % g->count]];
+		if(m->state != JOB_READY)
+			continue;
+		if(m->last_slot != -1 && slots[m->last_slot].job == NULL)
+			i = m->last_slot;
+		else
+			for(i=0; slots[i].job != NULL; i++)
+				;
+		run_in(i, m);
+		ready--;
+	}
+	g->next = (g->next + k) % g->count;
+	for(i=0; i<g->count; i++){
+		if(jobs[g->members[i]]->state == JOB_READY){
+			make_ready(jobs[g->members[i]]);
+			break;
+		}
+	}
+	return 1;
+}
+
+/*
+fills the idle slots from the ready queues, node by node: each job taken goes back
+to the slot it last ran in if that is idle, else to one sharing its last-level
+cache, else to the first idle one; slots[] lists one thread of every core before
+any SMT sibling, so jobs get cores of their own while there are spare ones
+with --gang, a gang taken off a queue holds back the idle slots until all of its
+ready members can run at once; the slots drain as other jobs' turns end
+*/
+void fill_idle_slots(){
+	static int idle[TOPO_MAX_CPUS];/*no allocation in the signal handlers*/
+	static proc_t *taken[TOPO_MAX_CPUS];
+	int node;
+	if(ready_q[0] == NULL)
+		return;
+	if(pending_gang != NULL && !run_gang(pending_gang))
+		return;
+	for(node=0; node<num_nodes && pending_gang == NULL; node++){
+		int nidle = 0, ntaken = 0, pass, i, j;
+		for(i=0; i<num_slots; i++){
+			if(slots[i].job == NULL && slots[i].where.node == node)
+				idle[nidle++] = i;
+		}
+		while(ntaken < nidle && take_job(node, &taken[ntaken])){
+			if(gang_mode && taken[ntaken]->gang != -1){
+				pending_gang = taken[ntaken];
+				break;
+			}
+			ntaken++;
+		}
+		for(pass=0; pass<3; pass++){/*same slot, same cache, any*/
+			for(j=0; j<ntaken; j++){
+				int last;
+				if(taken[j] == NULL)
+					continue;
+				last = taken[j]->last_slot;
+				for(i=0; i<nidle; i++){
+					if(idle[i] == -1
+					   || (pass == 0 && idle[i] != last)
+					   || (pass == 1 && (last == -1 || slots[idle[i]].where.llc != slots[last].where.llc)))
+						continue;
+					run_in(idle[i], taken[j]);
+					taken[j] = NULL;
+					idle[i] = -1;
+					break;
+				}
+			}
+		}
+	}
+	if(pending_gang != NULL)
+		run_gang(pending_gang);
+}
+
+/*
+once `job' has terminated, releases the jobs that run after it: a job whose
+dependencies have all succeeded starts waiting for admission, in O(out-degree);
+if `job' did not succeed, every job that depends on it, directly or not, is skipped
+called from the signal handlers and with the scheduler's signals blocked
+*/
+void release_dependents(proc_t *job, int succeeded){
+	long n, k, *list, top = 0;
+	if(dag == NULL)
+		return;
+	if(succeeded){
+		n = dag_dependents(dag, job->id, &list);
+		for(k=0; k<n; k++){
+			proc_t *dep = jobs[list[k]];
+			if(dep->state == JOB_BLOCKED && --dep->unmet == 0){
+				dep->state = JOB_WAITING;/*launched by admit_jobs()*/
+				blocked_jobs--;
+				waiting_jobs++;
+				if(dep->id < next_admit)
+					next_admit = dep->id;
+			}
+		}
+		return;
+	}
+	dag_stack[top++] = job->id;/*each job is pushed once, when it is skipped*/
+	while(top > 0){
+		n = dag_dependents(dag, dag_stack[--top], &list);
+		for(k=0; k<n; k++){
+			proc_t *dep = jobs[list[k]];
+			if(dep->state != JOB_BLOCKED)
+				continue;
+			dep->state = JOB_DONE;
+			dep->skipped = 1;
+			blocked_jobs--;
+			mx.jobs_finished++;
+			dag_stack[top++] = dep->id;
+		}
+	}
+}
+
+/*
+takes a job whose process, and with --subreaper its whole process group, has
+terminated off the CPU for good; called from the signal handlers and with the
+scheduler's signals blocked
+*/
+void finish_job(proc_t *job){
+	int status = job->wait_status;
+	if(tr_enabled())
+		tr_record(TR_EXIT, job->id, job->pid, (job->state == JOB_RUNNING) ? job->slot : 0, status);
+	if(job->state == JOB_RUNNING)
+		vacate(&slots[job->slot]);
+	else if(job->state == JOB_READY)
+		unqueue(job);/*killed from outside while waiting*/
+	gang_account(job);
+	if(job->home != -1)
+		node_load[job->home]--;
+	if(job->lingering){
+		job->lingering = 0;
+		lingering_jobs--;
+	}
+	job->state = JOB_DONE;
+	jt_done(job_tab, job->pid);
+	ln_release(&job->ln);
+	job->finished_at = tr_now();
+	active_processes--;
+	mx.jobs_finished++;
+	release_dependents(job, WIFEXITED(status) && WEXITSTATUS(status) == 0 && !job->cancelled);
+}
+
+/*
+records why the child `pid' could not run its command, see ln_failures()
+*/
+void note_failure(pid_t pid, int err){
+	int i = job_of(pid);
+	if(i >= 0)
+		jobs[i]->exec_errno = err;
+}
+
+/*
+follows a job's process through a stop or a continue reported by waitid()
+the scheduler's own SIGSTOP and SIGCONT agree with the job's state: it stops a
+job after taking its slot, and continues it after giving it one; anything else
+came from outside: a job stopped while it holds a slot gives it up and is held
+(paused) until it is continued, and a job continued out of turn is stopped again
+called from the SIGCHLD handler
+*/
+void stop_or_continue(proc_t *job, int stopped){
+	if(job->pstate == PS_NOT_STARTED || job->state == JOB_DONE)
+		return;/*e.g. the spawn engine's start gate*/
+	if(stopped){
+		job->pstate = PS_STOPPED;
+		if(job->state == JOB_RUNNING){
+			tr_record(TR_PREEMPT, job->id, job->pid, job->slot, 0);
+			vacate(&slots[job->slot]);
+			job->state = JOB_PAUSED;
+			job->held = 1;
+		}
+		return;
+	}
+	job->pstate = PS_RUNNING;
+	if(job->state != JOB_RUNNING){
+		signal_job(job, SIGSTOP);/*not its turn*/
+		if(job->held){
+			job->held = 0;
+			make_ready(job);
+		}
+	}
+}
+
 /*
 	following set of fucntion are signal handlers to execute upon receiving a signals
 */
+/*
+fills the idle slots; the time it takes is the pick-next phase, see hotpath.h
+*/
+void dispatch_idle(){
+	HP_BEGIN(mark);
+	fill_idle_slots();
+	HP_END(HP_PICK, mark);
+}
+
+/*
+jt_reap() callback: collects one event of the child `ev->pid'
+*/
+void reap_child(void *ctx, jt_event_t *ev){
+	int i = (int)ev->id, status = ev->status;
+	proc_t *job;
+	(void)ctx;
+	if(WIFSTOPPED(status) || WIFCONTINUED(status)){
+		if(i >= 0 && ev->pid == jobs[i]->pid)
+			stop_or_continue(jobs[i], WIFSTOPPED(status));
+		return;
+	}
+	if(i < 0){
+		/*not a job, e.g. the zygote launcher, or an orphan that left its job's group*/
+		if(subreaper && ev->pgid != -1 && ev->pgid != getpgrp()){
+			orphans_reaped++;
+			orphans_unattributed++;
+		}
+		return;
+	}
+	job = jobs[i];
+	if(ev->pid != job->pid){
+		job->orphans++;
+		job->orphan_ns += (ev->ru.ru_utime.tv_sec + ev->ru.ru_stime.tv_sec) * 1000000000L
+		                  + (ev->ru.ru_utime.tv_usec + ev->ru.ru_stime.tv_usec) * 1000L;
+		orphans_reaped++;
+		if(job->lingering && !group_alive(job))
+			finish_job(job);
+		return;
+	}
+	job->wait_status = status;
+	job->pstate = WIFEXITED(status) ? PS_EXITED : PS_SIGNALED;
+	if(WIFEXITED(status) && WEXITSTATUS(status) == LN_FAILED)
+		ln_failures(&note_failure);/*it may have exec'd a command that exits with 127*/
+	if(group_alive(job)){/*finished by reap_groups() or by its last orphan*/
+		job->lingering = 1;
+		lingering_jobs++;
+		return;
+	}
+	finish_job(job);
+}
+
 void sigchld_handler(int sig){
+	(void)sig;
 
 	/*
 		upon receiveing a SIGCHLD,
-		wait for dead processes
+		look at each child whose state has changed: exited, killed, stopped or continued,
+		then collect the event
 	*/
+	HP_BEGIN(mark);
 	sigset_t signal_set;
+	long events;
 	sigemptyset(&signal_set);
 	sigaddset(&signal_set, SIGALRM);
 	sigprocmask(SIG_BLOCK, &signal_set, NULL); /*block child signals*/
 
-	int status;
+	/*with --subreaper, an orphan adopted from a job's group goes to that job*/
+	events = jt_reap(job_tab, JT_ALL | (subreaper ? JT_GROUPS : 0), &reap_child, NULL);
+	HP_SYSCALLS(2 * events);
+	(void)events;
+	dispatch_idle();/*don't leave a slot idle until the next time slice*/
+
+
+	sigprocmask(SIG_UNBLOCK, &signal_set, NULL);
+	HP_SYSCALLS(3);/*the waitid() that found nothing, and the masks*/
+	HP_END(HP_REAP, mark);
+}
+void sigalrm_handler(int sig){
+	(void)sig;
+
+	/*	
+		upon receiving SIGALRM stop the processes whose turn is over,
+		add them to the end of their ready queue
+		fill the idle slots from the front of the ready queues
+		if a job has not started, start it; otherwise continue
+	*/
+	HP_BEGIN(mark);
+	sigset_t signal_set;
+	int i, budgets = 0;
+	int nothing_ready = tickless && pending_gang == NULL && ready_count() == 0;
+	sigemptyset(&signal_set);
+	sigaddset(&signal_set, SIGCHLD);
+	sigprocmask(SIG_BLOCK, &signal_set, NULL); /*block child signals*/
+
+	for(i=0; i<num_slots; i++){
+		proc_t *job = slots[i].job;
+		/*a job of weight w keeps its slot for w quanta*/
+		if(job == NULL || --job->ticks > 0)
+			continue;
+		if(nothing_ready){/*--tickless: it would be stopped only to be continued*/
+			job->ticks = job->weight;
+			if(job->cpu_budget > 0 || job->wall_budget > 0)
+				check_budget(job, tr_now());
+		}
+		else if(gang_mode && job->gang != -1)
+			preempt_gang(job->gang);/*a gang's turn ends with its first member's*/
+		else
+			preempt_slot(&slots[i]);
+	}
+	dispatch_idle();
+	if(tickless && pending_gang == NULL && ready_count() == 0){
+		for(i=0; i<num_slots; i++)
+			budgets += (slots[i].job != NULL && (slots[i].job->cpu_budget > 0 || slots[i].job->wall_budget > 0));
+		if(budgets == 0)
+			stop_timer();/*until a job is made ready; budgets are checked at slice ends*/
+	}
+
+
+	sigprocmask(SIG_UNBLOCK, &signal_set, NULL);
+	HP_SYSCALLS(2);
+	HP_END(HP_TIMER, mark);
+}
+
+/*
+block and unblock the scheduler's signals around changes made by the main loop
+*/
+void block_sched(){
+	sigprocmask(SIG_BLOCK, &sched_signals, NULL);
+}
+void unblock_sched(){
+	sigprocmask(SIG_UNBLOCK, &sched_signals, NULL);
+}
+
+/*
+setting up timer in milliseconds
+return 1 if sucessful, 0 otherwise
+*/
+int set_up_timer(){
+	if(quantum < 20 || quantum > 1000){
+		p1perror(2, "quantum value is not in this boundry: 20 <= quantum <=1000\n");
+		return 0;
+	}
+	struct itimerval new_value;
+	new_value.it_value.tv_sec = quantum/1000;;
+	new_value.it_value.tv_usec = (quantum*1000) % 1000000;
+	new_value.it_interval = new_value.it_value;
+
+	if(setitimer(ITIMER_REAL, &new_value, NULL) == -1){
+		p1perror(2, "error calling setitimer");
+		return 0;
+	}
+	timer_armed = 1;
+	HP_SYSCALLS(1);
+	return 1;
+}
+
+/*
+disarm the time slice timer
+*/
+void stop_timer(){
+	struct itimerval zero;
+	memset(&zero, 0, sizeof(zero));
+	setitimer(ITIMER_REAL, &zero, NULL);
+	timer_armed = 0;
+	HP_SYSCALLS(1);
+}
+
+/*
+makes room for `n' more jobs in the job table and on the ready queues
+return 1 if sucessful, 0 if out of memory
+*/
+int reserve_jobs(int n){
+	int cap = (job_cap == 0) ? 64 : job_cap;
+	int i;
+	if(num_jobs + n <= job_cap)
+		return 1;
+	while(cap < num_jobs + n)
+		cap *= 2;
+	if(!jt_reserve(job_tab, cap - num_jobs))
+		return 0;
+	jobs = (proc_t **)jt_jobs(job_tab);
+	job_cap = cap;
+	/*every job fits on the ready queue, so the handlers never make it grow*/
+	for(i=0; i<num_nodes; i++){
+		if(!pol_reserve(ready_q[i], cap))
+			return 0;
+	}
+	return mx_reserve(cap, placing ? num_nodes : 0);
+}
+
+/*
+adds a job to the job table; must be called with the scheduler's signals blocked
+returns the job, or NULL if out of memory
+*/
+proc_t *add_job(args_t *program, int prio, int weight, long deadline){
+	proc_t *job;
+	int i;
+	if(!reserve_jobs(1))
+		return NULL;
+	if(slab_next < slab_size){
+		job = &job_slab[slab_next++];
+		job->in_slab = 1;
+	}
+	else if((job = (proc_t *)malloc(sizeof(proc_t))) == NULL)
+		return NULL;
+	else
+		job->in_slab = 0;
+	job->id = num_jobs;
+	job->pid = 0;
+	job->status = 0;
+	job->state = JOB_WAITING;/*launched by admit_jobs()*/
+	job->prio = prio;
+	job->weight = (weight < 1) ? 1 : weight;
+	job->ticks = 0;
+	job->deadline = deadline;
+	job->cancelled = 0;
+	job->skipped = 0;
+	job->unmet = 0;
+	job->rank = 0;
+	job->index = -1;
+	job->parked = 0;
+	job->pstate = PS_NOT_STARTED;
+	job->held = 0;
+	job->exec_errno = 0;
+	job->lingering = 0;
+	job->cpu_budget = (program->cpu_budget > 0) ? program->cpu_budget : default_cpu_budget;
+	job->wall_budget = (program->wall_budget > 0) ? program->wall_budget : default_wall_budget;
+	job->started_at = 0;
+	job->over_budget = job->budget_sig = 0;
+	job->term_at = 0;
+	job->orphans = 0;
+	job->orphan_ns = 0;
+	job->wait_status = 0;
+	job->arrived_at = tr_now();
+	job->finished_at = 0;
+	job->cpu_ns = 0;
+	job->gang = job->slot = job->last_slot = job->home = -1;
+	job->migrations = 0;
+	for(i=0; i<TOPO_MAX_NODES; i++)
+		job->node_ns[i] = 0;
+	job->args = program->args;
+	job->exe = program->exe;
+	job->setup = NULL;
+	(void)jt_add(job_tab, job);/*reserved above, so it lands at job->id*/
+	num_jobs++;
+	mx_job_add(job->id);
+	waiting_jobs++;
+	if(dag != NULL){/*jobs submitted at run time are not in it*/
+		job->rank = dag_rank(dag, job->id);
+		if((job->unmet = dag_indegree(dag, job->id)) > 0){
+			job->state = JOB_BLOCKED;/*released by release_dependents()*/
+			waiting_jobs--;
+			blocked_jobs++;
+		}
+	}
+	mx.jobs_total = num_jobs + array_left;
+	return job;
+}
+
+/*
+adds a job to the gang called `name', creating the gang if it is the first member;
+must be called with the scheduler's signals blocked
+return 1 if sucessful, 0 if out of memory
+*/
+int join_gang(proc_t *job, char *name){
+	gang_t *g;
+	int i;
+	for(i=0; i<num_gangs && !p1strneq(gangs[i].name, name, p1strlen(name)+1); i++)
+		;
+	if(i == num_gangs){
+		if(num_gangs == gang_cap){
+			int cap = (gang_cap == 0) ? 8 : 2*gang_cap;
+			gang_t *tmp = (gang_t *)realloc(gangs, cap*sizeof(gang_t));
+			if(tmp == NULL)
+				return 0;
+			gangs = tmp;
+			gang_cap = cap;
+		}
+		g = &gangs[i];
+		memset(g, 0, sizeof(gang_t));
+		if((g->name = p1strdup(name)) == NULL)
+			return 0;
+		num_gangs++;
+	}
+	g = &gangs[i];
+	if(g->count == g->cap){
+		int cap = (g->cap == 0) ? 4 : 2*g->cap;
+		int *tmp = (int *)realloc(g->members, cap*sizeof(int));
+		if(tmp == NULL)
+			return 0;
+		g->members = tmp;
+		g->cap = cap;
+	}
+	g->members[g->count++] = job->id;
+	job->gang = i;
+	return 1;
+}
+
+/*
+launch a child that waits for its first dispatch, then executes the job's command
+must be called with the scheduler's signals blocked
+return 1 if sucessful; otherwise the job is marked as terminated and 0 is returned
+*/
+int launch(proc_t *job){
+	sigset_t alrm;
+	ln_setup_t *setup = job->setup;
+	int ok;
+	if(subreaper){/*the job's group is how its descendants are told apart*/
+		if(setup == NULL)
+			setup = &own_group;
+		else
+			setup->pgroup = 1;
+	}
+	sigemptyset(&alrm);
+	sigaddset(&alrm, SIGALRM);
+	/*the launcher's reply can take a while; let time slices end meanwhile (the table is consistent)*/
+	if(launch_engine == LN_ZYGOTE)
+		sigprocmask(SIG_UNBLOCK, &alrm, NULL);
+	ok = ln_launch(&job->ln, launch_engine, job->exe, job->args, setup);
+	if(launch_engine == LN_ZYGOTE)
+		sigprocmask(SIG_BLOCK, &alrm, NULL);
+	if(!ok){
+		job->state = JOB_DONE;
+		job->wait_status = LN_FAILED << 8;/*as if it had exited with 127, like a shell*/
+		mx.jobs_finished++;
+		release_dependents(job, 0);
+		return 0;
+	}
+	job->pid = job->ln.pid;
+	if(!jt_launched(job_tab, job->id, job->pid)){/*it could never be reaped as a job*/
+		p1perror(2, "Failed to index job pid\n");
+		kill(job->pid, SIGKILL);
+		while(waitpid(job->pid, NULL, 0) == -1 && errno == EINTR)
+			;
+		ln_release(&job->ln);
+		job->state = JOB_DONE;
+		job->wait_status = SIGKILL;
+		mx.jobs_finished++;
+		release_dependents(job, 0);
+		return 0;
+	}
+	mx_job_pid(job->id, job->pid);
+	if(job->cpu_budget > 0 && clock_getcpuclockid(job->pid, &job->cpu_clock) != 0)
+		job->cpu_budget = 0;/*can't be measured*/
+	active_processes++;
+	tr_record(TR_SPAWN, job->id, job->pid, 0, 0);
+	return 1;
+}
+
+/*
+frees a NULL-terminated argument list
+*/
+void free_args(char **args){
+	int i;
+	for(i=0; args[i] != NULL; ++i){
+		free(args[i]);
+	}
+	free(args);
+}
+
+/*
+returns a copy of `args' with every {} replaced by `index', NULL if out of memory
+*/
+char **expand_args(char **args, long index){
+	char num[25], **out;
+	int n, i, j, k, len;
+	p1ltoa(index, num);
+	len = p1strlen(num);
+	for(n=0; args[n] != NULL; n++)
+		;
+	if((out = (char **)malloc((n+1)*sizeof(char *))) == NULL)
+		return NULL;
+	for(i=0; i<n; i++){
+		int braces = 0;
+		for(j=0; args[i][j] != '\0'; j++)
+			braces += (args[i][j] == '{' && args[i][j+1] == '}');
+		if((out[i] = (char *)malloc(p1strlen(args[i]) + braces*len + 1)) == NULL){
+			out[i] = NULL;
+			free_args(out);
+			return NULL;
+		}
+		for(j=k=0; args[i][j] != '\0'; j++){
+			if(args[i][j] == '{' && args[i][j+1] == '}'){
+				p1strcpy(out[i]+k, num);
+				k += len;
+				j++;
+			}
+			else
+				out[i][k++] = args[i][j];
+		}
+		out[i][k] = '\0';
+	}
+	out[n] = NULL;
+	return out;
+}
+
+/*
+adds the next element of the workload's job arrays to the job table, with its
+arguments expanded from the array's template; must be called with the
+scheduler's signals blocked
+returns the job, or NULL if out of memory
+*/
+proc_t *next_element(){
+	proc_t *job;
+	char **args;
+	while(array_next > array_cursor->last){/*on to the next array of the workload*/
+		do
+			array_cursor = array_cursor->next;
+		while(array_cursor->first > array_cursor->last);
+		array_next = array_cursor->first;
+	}
+	if((args = expand_args(array_cursor->args, array_next)) == NULL)
+		return NULL;
+	if((job = add_job(array_cursor, 0, 1, 0L)) == NULL
+	   || (array_cursor->gang != NULL && !join_gang(job, array_cursor->gang))){
+		free_args(args);
+		return NULL;
+	}
+	job->args = args;/*the job owns them*/
+	job->index = array_next++;
+	job->arrived_at = workload_at;/*it was waiting to be expanded*/
+	array_left--;
+	return job;
+}
+
+/*
+launches waiting jobs in submission order while fewer than max_live are alive
+and puts them on the ready queue; the rest are launched as jobs terminate
+elements of job arrays are added to the job table as they are admitted, after
+the waiting jobs
+must be called with the scheduler's signals blocked
+*/
+void admit_jobs(){
+	if(psi_on && psi_throttled(tr_now()))
+		return;/*admitted once the pressure subsides*/
+	while((waiting_jobs > 0 || array_left > 0) && (max_live == 0 || active_processes < max_live)){
+		proc_t *job;
+		if(waiting_jobs == 0 && next_element() == NULL){
+			p1perror(2, "Failed to expand job array\n");
+			array_left = 0;
+			mx.jobs_total = num_jobs;
+			break;
+		}
+		while(jobs[next_admit]->state != JOB_WAITING)
+			next_admit++;
+		job = jobs[next_admit++];
+		waiting_jobs--;
+		if(launch(job))
+			make_ready(job);
+	}
+}
+
+/*
+installs the signal handlers, creates the ready queue and starts the time slice timer
+return 1 if sucessful, 0 otherwise
+*/
+int start_scheduler(long capacity){
+	sigset_t usr1;
+	int i;
+	/*subscribe SGICHLD and SIGALRM to sighandler*/
+	if(signal(SIGCHLD, &sigchld_handler) == SIG_ERR){
+		p1perror(2, "SIGCHLD SIGNAL SETUP FAILED\n");
+		return 0;
+	}
+	if(signal(SIGALRM, &sigalrm_handler) == SIG_ERR){
+		p1perror(2, "SIGALRM SIGNAL SETUP FAILED\n");
+		return 0;
+	}
+	/*SIGUSR1 stays blocked in the parent; children inherit it blocked and wait for it, see launch.h*/
+	sigemptyset(&usr1);
+	sigaddset(&usr1, SIGUSR1);
+	sigprocmask(SIG_BLOCK, &usr1, NULL);
+	sigemptyset(&sched_signals);
+	sigaddset(&sched_signals, SIGALRM);
+	sigaddset(&sched_signals, SIGCHLD);
+
+	ppid = getpid();/*get the parents ID and set ppid global variable to it*/
+	if((job_tab = jt_create()) == NULL){
+		p1perror(2, "Failed to create job table\n");
+		return 0;
+	}
+	for(i=0; i<num_nodes; i++){
+		ready_q[i] = pol_create(capacity);/*parent makes the ready queues*/
+		if(ready_q[i] == NULL){
+			p1perror(2, "Failed to create ready queue\n");
+			return 0;
+		}
+	}
+	return set_up_timer();/*set up time slice*/
+}
+
+/*
+copies the counters for a metrics scrape, every job's CPU time included, and
+brings the gangs' times up to date, as the handlers do; the scrape is formatted
+and sent once the scheduler's signals are unblocked again
+*/
+void snapshot_metrics(){
+	int i;
+	block_sched();
+	mx_snapshot(ready_count());
+	for(i=0; i<num_gangs; i++){
+		gang_account(jobs[gangs[i].members[0]]);
+		mx_gang_busy(gangs[i].name, gangs[i].busy_ns);
+	}
+	for(i=0; i<num_gangs; i++)
+		mx_gang_together(gangs[i].name, gangs[i].together_ns);
+	unblock_sched();
+}
+
+/*
+writes each gang's co-scheduling efficiency to standard error, one line per gang:
+	gang <name>: <n> members, busy <msec> ms, together <msec> ms (<percent>%)
+busy is the time at least one member held a slot, together the part of it during
+which every runnable member did
+*/
+void report_gangs(){
+	int i;
+	for(i=0; i<num_gangs; i++){
+		gang_t *g = &gangs[i];
+		p1bputstr(2, "gang ");
+		p1bputstr(2, g->name);
+		p1bputstr(2, ": ");
+		p1bputint(2, g->count);
+		p1bputstr(2, " members, busy ");
+		p1bputlong(2, g->busy_ns / 1000000L);
+		p1bputstr(2, " ms, together ");
+		p1bputlong(2, g->together_ns / 1000000L);
+		p1bputstr(2, " ms (");
+		p1bputlong(2, (g->busy_ns > 0) ? (long)(100.0 * g->together_ns / g->busy_ns) : 100L);
+		p1bputstr(2, "%)\n");
+	}
+	p1bflush(2);
+}
+
+/*
+releases the gang table
+*/
+void free_gangs(){
+	int i;
+	for(i=0; i<num_gangs; i++){
+		free(gangs[i].name);
+		free(gangs[i].members);
+	}
+	free(gangs);
+	gangs = NULL;
+	num_gangs = gang_cap = 0;
+}
+
+/*
+writes each job's node residency and migrations to standard error, one line per job:
+	placement: job <id> node <home> migrations <n> node_ms <node>:<msec>...
+*/
+void report_placement(){
+	int i, n;
+	for(i=0; i<num_jobs; i++){
+		p1bputstr(2, "placement: job ");
+		p1bputint(2, i);
+		p1bputstr(2, " node ");
+		p1bputint(2, jobs[i]->home);
+		p1bputstr(2, " migrations ");
+		p1bputint(2, jobs[i]->migrations);
+		p1bputstr(2, " node_ms");
+		for(n=0; n<num_nodes; n++){
+			p1bputstr(2, " ");
+			p1bputint(2, n);
+			p1bputstr(2, ":");
+			p1bputlong(2, jobs[i]->node_ns[n] / 1000000L);
+		}
+		p1bputstr(2, "\n");
+	}
+	p1bflush(2);
+}
+
+/*
+writes the scheduling-quality report to standard error, in the format of the
+simulator's, over the jobs that ran to the end: turnaround (from arrival to
+exit), response (to the first dispatch) and waiting (turnaround less the time
+holding a slot) distributions, Jain's index over the share of its turnaround
+each job held a slot, the slices that ended in a switch, and the fraction of
+the run some slot held a job
+*/
+void report_quality(){
+	Series turnaround, response, waiting, share;
+	uint64_t start = 0, end = 0;
+	long n = 0;
+	int i;
+	st_init(&turnaround, "turnaround");
+	st_init(&response, "response");
+	st_init(&waiting, "waiting");
+	st_init(&share, "cpu_share");
+	for(i=0; i<num_jobs; i++){
+		proc_t *job = jobs[i];
+		long ta;
+		if(job->state != JOB_DONE || job->started_at == 0)
+			continue;
+		ta = (long)(job->finished_at - job->arrived_at) / 1000;
+		if(!st_add(&turnaround, ta) || !st_add(&response, (long)(job->started_at - job->arrived_at) / 1000)
+		   || !st_add(&waiting, ta - job->cpu_ns / 1000)
+		   || !st_add(&share, (ta > 0) ? (long)(1000.0 * job->cpu_ns / ta) : 1000000L)){
+			p1putstr(2, "Failed to allocate the scheduling-quality report\n");
+			goto out;
+		}
+		if(n++ == 0 || job->arrived_at < start)
+			start = job->arrived_at;
+		if(job->finished_at > end)
+			end = job->finished_at;
+	}
+	if(n == 0)
+		goto out;
+	st_putcount(2, "jobs", n);
+	st_putcount(2, "quantum_ms", quantum);
+	st_putms(2, "makespan_ms", (long)(end - start) / 1000);
+	st_print(2, &turnaround);
+	st_print(2, &response);
+	st_print(2, &waiting);
+	st_putjain(2, "jain_fairness", &share);
+	st_putcount(2, "dispatches", mx.dispatches);
+	st_putcount(2, "context_switches", context_switches);
+	st_putpct(2, "cpu_utilization", busy_ns, (long)(end - start));
+	p1bflush(2);
+out:
+	st_free(&turnaround);
+	st_free(&response);
+	st_free(&waiting);
+	st_free(&share);
+}
+
+void control_command(char *line);
+void unschedule(proc_t *job);
+
+/*
+--subreaper: finishes the jobs whose process has exited once the rest of their
+group has too; the last of a group is not always reaped by the scheduler (its
+parent may still be in the group), so the main loop looks for empty groups
+must be called with the scheduler's signals blocked
+*/
+void reap_groups(){
+	int i;
+	for(i=0; i<num_jobs && lingering_jobs > 0; i++){
+		if(jobs[i]->lingering && !group_alive(jobs[i]))
+			finish_job(jobs[i]);
+	}
+}
+
+/*
+writes each job that exceeded a budget to standard error, with the signal that
+ended it:
+	budget: job <id> exceeded its cpu|wall budget of <msec> ms, SIGTERM|SIGKILL, exited=<n>|killed=<n>
+*/
+void report_budgets(){
+	int i;
+	for(i=0; i<num_jobs; i++){
+		proc_t *job = jobs[i];
+		if(job->over_budget == 0)
+			continue;
+		p1bputstr(2, "budget: job ");
+		p1bputint(2, i);
+		p1bputstr(2, (job->over_budget == BUDGET_CPU) ? " exceeded its cpu budget of " : " exceeded its wall budget of ");
+		p1bputlong(2, (job->over_budget == BUDGET_CPU) ? job->cpu_budget : job->wall_budget);
+		p1bputstr(2, (job->budget_sig == SIGKILL) ? " ms, SIGKILL, " : " ms, SIGTERM, ");
+		if(job->state != JOB_DONE)
+			p1bputstr(2, "not reaped");
+		else if(WIFEXITED(job->wait_status)){
+			p1bputstr(2, "exited=");
+			p1bputint(2, WEXITSTATUS(job->wait_status));
+		}
+		else{
+			p1bputstr(2, "killed=");
+			p1bputint(2, WTERMSIG(job->wait_status));
+		}
+		p1bputstr(2, "\n");
+	}
+	p1bflush(2);
+}
+
+/*
+writes the descendants each job left behind to standard error, one line per job
+that left any, then the totals:
+	subreaper: job <id> orphans <n> cpu_ms <msec>
+	subreaper: <n> orphaned descendants reaped, <n> not attributed to a job
+*/
+void report_orphans(){
+	int i;
+	for(i=0; i<num_jobs; i++){
+		if(jobs[i]->orphans == 0)
+			continue;
+		p1bputstr(2, "subreaper: job ");
+		p1bputint(2, i);
+		p1bputstr(2, " orphans ");
+		p1bputlong(2, jobs[i]->orphans);
+		p1bputstr(2, " cpu_ms ");
+		p1bputlong(2, jobs[i]->orphan_ns / 1000000L);
+		p1bputstr(2, "\n");
+	}
+	p1bputstr(2, "subreaper: ");
+	p1bputlong(2, orphans_reaped);
+	p1bputstr(2, " orphaned descendants reaped, ");
+	p1bputlong(2, orphans_unattributed);
+	p1bputstr(2, " not attributed to a job\n");
+	p1bflush(2);
+}
+
+/*
+on a pressure event, takes the job with the largest resident set off the CPU,
+unless it is the last one left to run; each event (at most one per trigger
+window while the pressure lasts) parks one more job
+must be called with the scheduler's signals blocked
+*/
+void park_heaviest(){
+	proc_t *heaviest = NULL;
+	long max_kb = -1, kb;
+	int i, runnable = 0;
+	for(i=0; i<num_jobs; i++){
+		if(jobs[i]->state != JOB_READY && jobs[i]->state != JOB_RUNNING)
+			continue;
+		runnable++;
+		if((kb = psi_rss_kb(jobs[i]->pid)) > max_kb){
+			max_kb = kb;
+			heaviest = jobs[i];
+		}
+	}
+	if(runnable > 1){
+		unschedule(heaviest);
+		heaviest->parked = 1;
+		parked_jobs++;
+	}
+}
+
+/*
+puts the parked jobs back on the ready queue once the pressure has subsided
+must be called with the scheduler's signals blocked
+*/
+void unpark_all(){
+	int i;
+	for(i=0; i<num_jobs && parked_jobs > 0; i++){
+		if(!jobs[i]->parked)
+			continue;
+		jobs[i]->parked = 0;
+		parked_jobs--;
+		if(jobs[i]->state == JOB_PAUSED)
+			make_ready(jobs[i]);
+	}
+}
+
+/*
+--tickless: with the timer stopped there is nothing to look at every 20 ms,
+so the loop sleeps until a signal, e.g. the SIGCHLD of a job that is done
+*/
+void wait_for_signal(){
+	sigset_t old;
+	int quiet;
+	sigprocmask(SIG_BLOCK, &sched_signals, &old);
+	quiet = !timer_armed && active_processes > 0 && lingering_jobs == 0 && !psi_on && waiting_jobs == 0 && array_left == 0;
+	if(quiet)
+		sigsuspend(&old);/*no signal is lost between the test and the sleep*/
+	sigprocmask(SIG_SETMASK, &old, NULL);
+	if(!quiet)
+		(void)nanosleep(&ms20, NULL);
+}
+
+/*
+waits up to 20 ms for something to do, then does the main loop's share of the
+work: draining the trace ring, answering metrics scrapes and control requests;
+dispatching itself happens in the signal handlers
+*/
+void event_loop_once(){
+	struct pollfd pfd[2 + PSI_MAX_TRIGGERS];
+	int psi[PSI_MAX_TRIGGERS];
+	int n = 0;
+	int i, npsi = psi_fds(psi);
+	for(i=0; i<npsi; i++){
+		pfd[n].fd = psi[i];
+		pfd[n++].events = POLLPRI;
+	}
+	if(mx_fd() != -1){
+		pfd[n].fd = mx_fd();
+		pfd[n++].events = POLLIN;
+	}
+	if(ctl_fd() != -1){
+		pfd[n].fd = ctl_fd();
+		pfd[n++].events = POLLIN;
+	}
+	if(n == 0 && tickless)
+		wait_for_signal();
+	else if(n == 0)
+		(void)nanosleep(&ms20, NULL);
+	else if(poll(pfd, n, 20) > 0){
+		for(i=0; i<n; i++){
+			if(i < npsi && (pfd[i].revents & (POLLPRI | POLLERR))){
+				psi_event(pfd[i].fd, tr_now());
+				block_sched();
+				park_heaviest();
+				dispatch_idle();
+				unblock_sched();
+				continue;
+			}
+			if(!(pfd[i].revents & POLLIN))
+				continue;
+			if(pfd[i].fd == mx_fd()){
+				mx_serve(&snapshot_metrics);
+			}
+			else
+				ctl_serve(&control_command);
+		}
+	}
+	if(mx_fd() != -1)
+		mx_tick();
+	tr_flush();/*drain the trace ring outside of the signal handlers*/
+	if(psi_on){
+		uint64_t now = tr_now();
+		mx.throttled = psi_throttled(now);
+		mx.throttled_ns = (long)psi_throttled_ns(now, NULL);
+		if(parked_jobs > 0 && !mx.throttled){
+			block_sched();
+			unpark_all();
+			dispatch_idle();
+			unblock_sched();
+		}
+	}
+	if(lingering_jobs > 0){
+		block_sched();
+		reap_groups();
+		dispatch_idle();
+		unblock_sched();
+	}
+	if(waiting_jobs > 0 || array_left > 0){/*a SIGCHLD cuts the wait short, so slots are refilled right away*/
+		block_sched();
+		admit_jobs();
+		dispatch_idle();
+		unblock_sched();
+	}
+}
+
+/*
+clean up routine
+*/
+void clean_up(args_t *head){
+	if(head == NULL)
+		return;
+	args_t *tmp = head->next;
+	if(head->args != NULL)
+		free_args(head->args);
+	free(head->gang);
+	free(head->name);
+	free(head->after);
+	free(head);
+	if(tmp != NULL)
+		clean_up(tmp);
+}
+
+/*
+releases the job table
+*/
+void free_jobs(){
+	int i;
+	for(i=0; i<num_jobs; i++){
+		if(jobs[i]->setup != NULL){
+			free(jobs[i]->setup->in);
+			free(jobs[i]->setup->out);
+			free(jobs[i]->setup->err);
+			free(jobs[i]->setup);
+		}
+		if(jobs[i]->index != -1)
+			free_args(jobs[i]->args);
+		if(!jobs[i]->in_slab)
+			free(jobs[i]);
+	}
+	free(job_slab);
+	if(job_tab != NULL)
+		jt_destroy(job_tab);
+	job_tab = NULL;
+	jobs = NULL;
+	job_slab = NULL;
+	num_jobs = job_cap = 0;
+	slab_next = slab_size = 0;
+}
 
-	while(waitpid(-1, &status, WNOHANG)>0){
-		if(WIFEXITED(status)){
-				active_processes--;
+/*
+adds the jobs of the workload to the job table; a job array only counts its
+elements, which are added as they are admitted, see next_element()
+the other jobs are allocated in one block, with room in the table made up front
+must be called with the scheduler's signals blocked
+return 1 if sucessful, 0 if out of memory
+*/
+int add_workload(args_t *program){
+	args_t *tmp;
+	int n = 0;
+	workload_at = tr_now();
+	for(tmp = program; tmp != NULL; tmp = tmp->next)
+		n += (tmp->first > tmp->last);
+	if(n > 0){
+		if(!reserve_jobs(n) || (job_slab = (proc_t *)malloc(n*sizeof(proc_t))) == NULL)
+			return 0;
+		slab_size = n;
+	}
+	for(tmp = program; tmp != NULL; tmp = tmp->next){
+		proc_t *job;
+		if(tmp->first <= tmp->last){
+			if(array_cursor == NULL){
+				array_cursor = tmp;
+				array_next = tmp->first;
 			}
+			array_left += tmp->last - tmp->first + 1;
+			continue;
+		}
+		job = add_job(tmp, 0, 1, 0L);
+		if(job == NULL || (tmp->gang != NULL && !join_gang(job, tmp->gang)))
+			return 0;
 	}
+	mx.jobs_total = num_jobs + array_left;
+	return 1;
+}
+
+/*
+fork children and have them execute a command
+*/
+void execute_cmds(args_t *program, int num_progs){
+	if(!start_scheduler(num_progs))
+		return;
 
+	block_sched();
+	if(!add_workload(program))
+		p1perror(2, "Failed to allocate job table\n");
+	admit_jobs();/*launch them all, or the first max_live; they go on the ready queue*/
+	dispatch_idle();/*remove the first elements of the ready queues and run them*/
+	unblock_sched();
 
-	sigprocmask(SIG_UNBLOCK, &signal_set, NULL);
+	while(active_processes || waiting_jobs || blocked_jobs || array_left){/*wait until all child processes are done*/
+		event_loop_once();
+	}
+	stop_timer();
 }
-void sigusr1_handler(int sig){
 
-	/*
-		upon receiving SIGUSR1 add the pid to ready queue
-	*/
-	pid_t ID = getpid();
-	if(ID != ppid)
-		child_received = 1;
-	
+/*
+processes command, form stdin or workload file
+returns an argumentLL if successful, NULL otherwise
+*/
+args_t *process_cmd(char *line){
+	wl_line_t l;
+	args_t *program;
+	if(wl_parse(line, &l) != 1)/*no command, or out of memory*/
+		return NULL;
+	program = (args_t *)malloc(sizeof(args_t));
+	if(program == NULL){
+		wl_free(&l);
+		return NULL;
+	}
+	program->next = NULL;
+	program->args = l.args;
+	program->gang = l.gang;
+	program->name = l.name;
+	program->after = l.after;
+	program->first = l.first;
+	program->last = l.last;
+	program->cpu_budget = l.cpu_budget;
+	program->wall_budget = l.wall_budget;
+	program->exe = ln_resolve(l.args[0]);/*once per distinct command, errno tells why not*/
+	return program;
 }
-void sigalrm_handler(int sig){
 
-	/*	
-		upon receiving SIGALRM stop the process,
-		add it to the end of ready queue
-		get the first element of the ready queue
-		if has not started, start it; otherwise continue
-	*/
-	sigset_t signal_set;
-	sigemptyset(&signal_set);
-	sigaddset(&signal_set, SIGCHLD);
-	sigprocmask(SIG_BLOCK, &signal_set, NULL); /*block child signals*/
+/*
+parses a decimal integer with an optional sign
+*/
+int parse_int(char *s){
+	if(s[0] == '-')
+		return -p1atoi(s+1);
+	return p1atoi(s);
+}
 
+/*
+returns the monotonic clock in msec, the unit of job deadlines
+*/
+long now_ms(){
+	return (long)(tr_now() / 1000000ULL);
+}
 
-	kill(ID->pid, SIGSTOP);
-	bq_add(ready_q, ID); /*add process to the ready queue*/
-	if(!bq_remove(ready_q, (void **)(&ID))){
+/*
+looks up the job named by the decimal id in `word'; replies with an error if there is none
+ids of more than 9 digits are refused before conversion, so that p1atoi() cannot overflow
+*/
+proc_t *lookup_job(char *word){
+	int id, i;
+	for(i=0; word[i] >= '0' && word[i] <= '9'; i++)
+		;
+	if(i == 0 || word[i] != '\0'){
+		ctl_reply("error expected a job id\n");
+		return NULL;
 	}
-	
-	if(ID->status == 1)
-		kill(ID->pid, SIGCONT);
-
-	if(!ID->status){
-		ID->status = 1;
-		kill(ID->pid, SIGUSR1);
+	if(i > 9 || (id = p1atoi(word)) < 0 || id >= num_jobs){
+		ctl_reply("error no such job\n");
+		return NULL;
 	}
-	
-
-	sigprocmask(SIG_UNBLOCK, &signal_set, NULL);
+	return jobs[id];
 }
 
 /*
-setting up timer in milliseconds
-return 1 if sucessful, 0 otherwise
+takes a job off its CPU slot or the ready queue, e.g. to pause or cancel it
 */
-int set_up_timer(){
-	if(quantum < 20 || quantum > 1000){
-		p1perror(2, "quantum value is not in this boundry: 20 <= quantum <=1000\n");
-		return 0;
+void unschedule(proc_t *job){
+	if(job->state == JOB_RUNNING){
+		signal_job(job, SIGSTOP);
+		tr_record(TR_PREEMPT, job->id, job->pid, job->slot, 0);
+		vacate(&slots[job->slot]);
 	}
-	struct itimerval new_value;
-	new_value.it_value.tv_sec = quantum/1000;;
-	new_value.it_value.tv_usec = (quantum*1000) % 1000000;
-	new_value.it_interval = new_value.it_value;
+	else if(job->state == JOB_READY){
+		unqueue(job);
+		gang_account(job);
+	}
+	job->state = JOB_PAUSED;
+}
 
-	if(setitimer(ITIMER_REAL, &new_value, NULL) == -1){
-		p1perror(2, "error calling setitimer");
+/*
+parses one of the process setup options of submit into `setup'
+returns 1 if `word' was one, 0 if not, -1 if out of memory
+*/
+int parse_setup(char *word, ln_setup_t *setup){
+	char **file = NULL;
+	if(p1strneq(word, "pgroup=", 7))
+		setup->pgroup = p1atoi(word+7);
+	else if(p1strneq(word, "cpu=", 4))
+		setup->cpu = p1atoi(word+4);
+	else if(p1strneq(word, "nofile=", 7))
+		setup->nofile = p1atoi(word+7);
+	else if(p1strneq(word, "mem=", 4))
+		setup->mem_mb = p1atoi(word+4);
+	else if(p1strneq(word, "stdin=", 6))
+		file = &setup->in;
+	else if(p1strneq(word, "stdout=", 7))
+		file = &setup->out;
+	else if(p1strneq(word, "stderr=", 7))
+		file = &setup->err;
+	else
 		return 0;
+	if(file != NULL){
+		free(*file);
+		if((*file = p1strdup(word+p1strchr(word, '=')+1)) == NULL)
+			return -1;
 	}
 	return 1;
 }
 
 /*
-clean up routine
+submit [prio=<n>] [weight=<n>] [deadline=<msec>] [gang=<name>] [pgroup=1] [cpu=<n>]
+	[nofile=<n>] [mem=<MB>] [stdin|stdout|stderr=<file>]
+	[cpu_budget=<msec>] [wall_budget=<msec>] command [args...]
 */
-void clean_up(args_t *head){
-	args_t *tmp = head->next;
-	if(head == NULL)
+void ctl_submit(char *rest){
+	int prio = 0, weight = 1;
+	long deadline = 0L;
+	int i = 0, j, k;
+	args_t *program;
+	proc_t *job;
+	ln_setup_t setup;
+	char word[p1strlen(rest)+1], gang[p1strlen(rest)+1];
+
+	ln_defaults(&setup);
+	gang[0] = '\0';
+	for(;;){
+		j = p1getword(rest, i, word);
+		if(j == -1)
+			break;
+		if(p1strneq(word, "prio=", 5))
+			prio = parse_int(word+5);
+		else if(p1strneq(word, "weight=", 7))
+			weight = p1atoi(word+7);
+		else if(p1strneq(word, "deadline=", 9))
+			deadline = now_ms() + p1atoi(word+9);
+		else if(p1strneq(word, "gang=", 5))
+			p1strcpy(gang, word+5);
+		else if((k = parse_setup(word, &setup)) == -1){
+			ctl_reply("error out of memory\n");
+			goto out;
+		}
+		else if(k == 0)
+			break;
+		i = j;
+	}
+	if((program = process_cmd(rest+i)) == NULL){
+		ctl_reply("error expected a command\n");
+		goto out;
+	}
+	if(program->first <= program->last){
+		ctl_reply("error job arrays are only accepted in workload files\n");
+		clean_up(program);
+		goto out;
+	}
+	if(program->exe == -1){
+		ctl_reply((errno == EACCES) ? "error permission denied: " : "error command not found: ");
+		ctl_reply(program->args[0]);
+		ctl_reply("\n");
+		clean_up(program);
+		goto out;
+	}
+	if((job = add_job(program, prio, weight, deadline)) == NULL){
+		clean_up(program);
+		ctl_reply("error out of memory\n");
+		goto out;
+	}
+	program->next = submitted;/*the job borrows the command; it is freed at exit*/
+	submitted = program;
+	if(setup.pgroup || setup.cpu >= 0 || setup.nofile || setup.mem_mb
+	   || setup.in != NULL || setup.out != NULL || setup.err != NULL){
+		if((job->setup = (ln_setup_t *)malloc(sizeof(ln_setup_t))) == NULL){
+			job->state = JOB_DONE;
+			waiting_jobs--;
+			ctl_reply("error out of memory\n");
+			goto out;
+		}
+		*job->setup = setup;/*the job owns the file names now*/
+	}
+	if(gang[0] != '\0' && !join_gang(job, gang)){
+		job->state = JOB_DONE;
+		waiting_jobs--;
+		ctl_reply("error out of memory\n");
+		return;
+	}
+	admit_jobs();/*it may have to wait for a slot*/
+	if(job->state == JOB_DONE){
+		ctl_reply("error launch failed\n");
 		return;
-	if(head->args != NULL){
-		int i;
-		for(i=0; head->args[i] != NULL; ++i){
-			free(head->args[i]);
+	}
+	ctl_reply("ok ");
+	ctl_replylong(job->id);
+	ctl_reply("\n");
+	return;
+out:
+	free(setup.in);
+	free(setup.out);
+	free(setup.err);
+}
+
+/*
+writes one line of status for a job
+*/
+void ctl_status(proc_t *job){
+	static char *states[] = {"ready", "running", "paused", "done", "waiting", "blocked"};
+	static char *pstates[] = {"not_started", "running", "stopped", "exited", "signaled"};
+	long cpu_ns = job->cpu_ns;
+	if(job->state == JOB_RUNNING)
+		cpu_ns += tr_now() - slots[job->slot].dispatched_at;/*the slice in progress*/
+	ctl_replylong(job->id);
+	ctl_reply(" ");
+	if(job->state != JOB_DONE)
+		ctl_reply(states[job->state]);
+	else if(job->cancelled)
+		ctl_reply("cancelled");
+	else if(job->skipped)
+		ctl_reply("skipped");
+	else if(WIFEXITED(job->wait_status)){
+		ctl_reply("exited=");
+		ctl_replylong(WEXITSTATUS(job->wait_status));
+	}
+	else{
+		ctl_reply("killed=");
+		ctl_replylong(WTERMSIG(job->wait_status));
+	}
+	ctl_reply(" pid=");
+	ctl_replylong(job->pid);
+	ctl_reply(" prio=");
+	ctl_replylong(job->prio);
+	ctl_reply(" weight=");
+	ctl_replylong(job->weight);
+	ctl_reply(" cpu_ms=");
+	ctl_replylong(cpu_ns / 1000000L);
+	if(job->pid != 0){
+		ctl_reply(" process=");
+		ctl_reply(pstates[job->pstate]);
+	}
+	if(job->held)
+		ctl_reply(" held");
+	if(job->exec_errno != 0){
+		ctl_reply(" exec_errno=");
+		ctl_replylong(job->exec_errno);
+	}
+	if(job->over_budget != 0){
+		ctl_reply((job->over_budget == BUDGET_CPU) ? " over=cpu" : " over=wall");
+		ctl_reply((job->budget_sig == SIGKILL) ? " budget_signal=kill" : " budget_signal=term");
+	}
+	if(job->parked)
+		ctl_reply(" parked");
+	if(job->gang != -1){
+		ctl_reply(" gang=");
+		ctl_reply(gangs[job->gang].name);
+	}
+	if(subreaper){
+		if(job->lingering)
+			ctl_reply(" lingering");
+		ctl_reply(" orphans=");
+		ctl_replylong(job->orphans);
+		ctl_reply(" orphan_ms=");
+		ctl_replylong(job->orphan_ns / 1000000L);
+	}
+	if(placing){
+		int n;
+		ctl_reply(" node=");
+		ctl_replylong(job->home);
+		ctl_reply(" migrations=");
+		ctl_replylong(job->migrations);
+		ctl_reply(" node_ms=");
+		for(n=0; n<num_nodes; n++){
+			if(n > 0)
+				ctl_reply(",");
+			ctl_replylong(n);
+			ctl_reply(":");
+			ctl_replylong(job->node_ns[n] / 1000000L);
 		}
-		free(head->args[i]);
-		free(head->args);
 	}
-	free(head);
-	if(tmp != NULL)
-		clean_up(tmp);
+	if(job->deadline != 0L){
+		if(job->state != JOB_DONE)
+			ctl_reply((now_ms() > job->deadline) ? " deadline=missed" : " deadline=pending");
+		else
+			ctl_reply(((long)(job->finished_at / 1000000ULL) > job->deadline) ? " deadline=missed" : " deadline=met");
+	}
+	ctl_reply(" ");
+	ctl_reply(job->args[0]);
+	ctl_reply("\n");
 }
 
 /*
-fork children and have them execute a command
+interprets one line of a control request:
+	submit [prio=<n>] [weight=<n>] [deadline=<msec>] [gang=<name>] [<setup option>=<value>...] command [args...]
+	cancel <id> | pause <id> | resume <id> | prio <id> <n>
+	status [<id>] | shutdown
 */
-void execute_cmds(args_t *program, int num_progs){
-	// pid_t pid[num_progs];
-	proc_t pids[num_progs];
+void control_command(char *line){
+	int len = p1strlen(line);
+	proc_t *job = NULL;
 	int i;
-	args_t *tmp = program;
-	int status;
-	/*subscribe SIGUSR1 and SGICHLD to sighandler*/
-	if(signal(SIGUSR1, &sigusr1_handler) == SIG_ERR){
-		p1perror(2, "SIGUSR1 SIGNAL SETUP FAILED\n");
+
+	if(len > CTL_LINE_MAX){
+		ctl_reply("error line too long\n");
 		return;
 	}
-	if(signal(SIGCHLD, &sigchld_handler) == SIG_ERR){
-		p1perror(2, "SIGCHLD SIGNAL SETUP FAILED\n");
+	char cmd[len+1], arg[len+1], arg2[len+1];
+	if((i = p1getword(line, 0, cmd)) == -1)
 		return;
+	arg[0] = arg2[0] = '\0';
+	block_sched();
+	if(p1strneq(cmd, "submit", 7)){
+		ctl_submit(line+i);
 	}
-	if(signal(SIGALRM, &sigalrm_handler) == SIG_ERR){
-		p1perror(2, "SIGALRM SIGNAL SETUP FAILED\n");
-		return;
+	else if(p1strneq(cmd, "status", 7)){
+		if((i = p1getword(line, i, arg)) == -1){
+			int j;
+			for(j=0; j<num_jobs; j++)
+				ctl_status(jobs[j]);
+			for(j=0; j<num_gangs; j++){
+				gang_account(jobs[gangs[j].members[0]]);
+				ctl_reply("gang ");
+				ctl_reply(gangs[j].name);
+				ctl_reply(" members=");
+				ctl_replylong(gangs[j].count);
+				ctl_reply(" busy_ms=");
+				ctl_replylong(gangs[j].busy_ns / 1000000L);
+				ctl_reply(" together_ms=");
+				ctl_replylong(gangs[j].together_ns / 1000000L);
+				ctl_reply("\n");
+			}
+			ctl_reply("ok\n");
+		}
+		else if((job = lookup_job(arg)) != NULL)
+			ctl_status(job);
 	}
-
-
-	if(set_up_timer() == 0)/*set up time slice*/
-		return;/*setting up timer failed*/
-	active_processes = num_progs;
-	for(i=0; i< num_progs; i++){
-		pids[i].pid = fork();/*fork children*/
-		pids[i].status = 0; /*set the status to 0 to show that it's not running*/
-		if(pids[i].pid < 0){
-			p1perror(2, "Failed to fork\n");
-			return;
+	else if(p1strneq(cmd, "shutdown", 9)){
+		shutting_down = 1;
+		ctl_reply("ok ");
+		ctl_replylong(active_processes + waiting_jobs + blocked_jobs + array_left);
+		ctl_reply(" jobs left\n");
+	}
+	else if(p1strneq(cmd, "cancel", 7) || p1strneq(cmd, "pause", 6)
+	        || p1strneq(cmd, "resume", 7) || p1strneq(cmd, "prio", 5)){
+		if((i = p1getword(line, i, arg)) == -1)
+			ctl_reply("error expected a job id\n");
+		else if((job = lookup_job(arg)) == NULL)
+			;
+		else if(job->state == JOB_DONE)
+			ctl_reply("error job has terminated\n");
+		else if(cmd[0] == 'c' && (job->state == JOB_WAITING || job->state == JOB_BLOCKED)){
+			if(job->state == JOB_WAITING)
+				waiting_jobs--;
+			else
+				blocked_jobs--;
+			job->state = JOB_DONE;/*never launched, nothing to kill*/
+			job->cancelled = 1;
+			mx.jobs_finished++;
+			release_dependents(job, 0);
+			ctl_reply("ok\n");
 		}
-		else if(pids[i].pid == 0){/*child, have them execute the command*/
-			while(!child_received);/*wait till receiving signal*/
-			execvp(*(tmp->args), tmp->args);
-			/*failed to execute*/
-			p1perror(2, "Execution failed\n");
-			/*not exiting but retruning because we need to do the clean up routine*/
-			return;
+		else if(cmd[0] == 'c'){
+			unschedule(job);
+			job->cancelled = 1;
+			signal_job(job, SIGKILL);
+			ctl_reply("ok\n");
+		}
+		else if(cmd[0] == 'r'){
+			job->held = 0;/*stopped from outside: the scheduler's SIGCONT resumes it*/
+			if(job->state == JOB_PAUSED)
+				make_ready(job);
+			ctl_reply("ok\n");
+		}
+		else if(cmd[1] == 'a' && (job->state == JOB_WAITING || job->state == JOB_BLOCKED))
+			ctl_reply("error job has not been launched\n");
+		else if(cmd[1] == 'a'){
+			unschedule(job);
+			job->held = 0;/*paused by the user, whoever continues it*/
+			if(job->parked){/*the user's pause outlasts the governor's*/
+				job->parked = 0;
+				parked_jobs--;
+			}
+			ctl_reply("ok\n");
+		}
+		else if(p1getword(line, i, arg2) == -1)
+			ctl_reply("error expected a priority\n");
+		else{
+			job->prio = parse_int(arg2);
+			if(job->state == JOB_READY){
+				unqueue(job);
+				make_ready(job);
+			}
+			ctl_reply("ok\n");
 		}
-		tmp = tmp->next;
 	}
+	else
+		ctl_reply("error unknown command\n");
+	dispatch_idle();
+	unblock_sched();
+}
 
-	/*
-	 *	PARENT
-	 */
-
-	ppid = getpid();/*get the parents ID and set ppid global variable to it*/
-	ready_q = bq_create(num_progs);/*parent makes the ready queue*/
-	if(ready_q == NULL){
-		p1perror(2, "Failed to create ready queue\n");
+/*
+runs the scheduler as a daemon: the jobs of the workload (if any) are started
+right away, more arrive through the control socket, and the daemon exits after
+a shutdown request once every job has terminated
+*/
+void run_daemon(args_t *program){
+	if(!start_scheduler(0L))
 		return;
-	}
+	block_sched();
+	(void)add_workload(program);
+	admit_jobs();
+	dispatch_idle();
+	unblock_sched();
+
+	while(!shutting_down || active_processes || waiting_jobs || blocked_jobs || array_left)
+		event_loop_once();
+	stop_timer();
+}
 
-	/*parent adds all child process IDs to the ready queue*/
-	for(i=0; i<num_progs; i++){
-		/*send signal to children*/
-		if(!bq_add(ready_q, &(pids[i]))){
-			p1perror(2, "Failed to add proccesses to ready queue");
+/*
+sets up `n' slots on CPUs chosen from the topology and the scheduler's own affinity
+mask, or a single slot that is not pinned anywhere if `n' is 0
+return 1 if sucessful, 0 otherwise
+*/
+int set_up_slots(int n){
+	static topo_cpu_t cpus[TOPO_MAX_CPUS], chosen[TOPO_MAX_CPUS];
+	cpu_set_t allowed;
+	int ncpus, i, j;
+	if(n > TOPO_MAX_CPUS){
+		p1putstr(2, "--cpus: too many slots\n");
+		return 0;
+	}
+	num_slots = (n == 0) ? 1 : n;
+	if((slots = (slot_t *)calloc(num_slots, sizeof(slot_t))) == NULL){
+		p1perror(2, "Failed to allocate slots\n");
+		return 0;
+	}
+	if(n == 0){
+		slots[0].where.cpu = -1;/*node 0, like everything else*/
+		return 1;
+	}
+	placing = 1;
+	ncpus = topo_read(cpus, TOPO_MAX_CPUS);
+	if(sched_getaffinity(0, sizeof(allowed), &allowed) == 0){
+		for(i=j=0; i<ncpus; i++){
+			if(cpus[i].cpu < CPU_SETSIZE && CPU_ISSET(cpus[i].cpu, &allowed))
+				cpus[j++] = cpus[i];
 		}
+		if(j > 0)
+			ncpus = j;
 	}
-	/*remove the first element of ready queue and run it*/
-	bq_remove(ready_q, (void **)(&ID));
-	ID->status = 1;/*about to start*/
-	kill(ID->pid, SIGUSR1);
-	while(active_processes){/*wait until all child processes are done*/
-		(void)nanosleep(&ms20, NULL);
+	topo_pick(cpus, ncpus, num_slots, chosen);
+	node_slots[0] = 0;
+	for(i=0; i<num_slots; i++){
+		slots[i].where = chosen[i];
+		node_slots[chosen[i].node]++;
 	}
+	num_nodes = topo_nodes(chosen, num_slots);
+	return 1;
 }
 
 /*
-Helper function that counts the number of arguments in a line passed and returns it
-it ccounts the arguments passed in quotation marks, as one word
+resolves the name= and after= attributes of the workload's lines into the
+dependency graph; the jobs' ids are their line numbers among the jobs that are
+not job arrays, whose elements are added later
+return 1 if sucessful, 0 otherwise (the reason has been written to standard error)
 */
-int get_word_count(char *line){
-	int i=0;
-	int count = 0;
-	int word_char = 0;	/*this flag gets set everytime we see a char*/
-					   	/* and resets when we see a whitespace*/
-	int len=p1strlen(line);
-	while(line[i]==' ' || line[i]=='\t' || line[i]=='\n' || line[i]=='\'' || line[i]=='\"')
-		i++;
-	if(i>=len)
-		return count;
-	while(line[i] != '\0'){
-		if(line[i]!=' ' && line[i]!='\t' && line[i]!='\n' && line[i]!='\'' && line[i]!='\"'){
-			count++;
-			word_char = 1;/*now we're parsing a word*/
-		}
-		while(word_char){
-			i++;
-			if(line[i]=='\0' || line[i]==' ' || line[i]=='\t' || line[i]=='\n' || line[i]=='\'' || line[i]=='\"')
-				word_char = 0;/*we're no longer processing the word*/
-		}
-		if(line[i] != '\0')
-			i++;
+int build_dag(args_t *head){
+	args_t *tmp;
+	long i = 0;
+	for(tmp = head; tmp != NULL; tmp = tmp->next)
+		i += (tmp->first > tmp->last);/*job arrays are not in it*/
+	dag = dag_create(i);
+	dag_stack = (long *)malloc((i+1)*sizeof(long));
+	if(dag == NULL || dag_stack == NULL){
+		p1perror(2, "Failed to allocate dependency graph\n");
+		return 0;
+	}
+	i = 0;
+	for(tmp = head; tmp != NULL; tmp = tmp->next){
+		if(tmp->first > tmp->last)
+			dag_set(dag, i++, tmp->name, tmp->after);
 	}
-	return count;
+	return dag_build(dag);
 }
+
 /*
-processes command, form stdin or workload file
-returns an argumentLL if successful, NULL otherwise
+lays out the jobs of the compiled image open on `fd' as a workload list, without
+parsing or copying anything: the commands and attributes point into the mapped
+image, the list is in image_args and the argument lists in image_argv
+jobs whose command can't be resolved are reported and left out, as for text
+return 1 if sucessful, 0 otherwise (the reason has been written to standard error)
 */
-args_t *process_cmd(char *line){
-	int len = p1strlen(line);
-	if(line[len-1]=='\n')
-		line[len-1]='\0';
-	int count = get_word_count(line);
-	if(count == 0)
-		return NULL;
-
-	count++; /*count will tell us how much memory to allocate for the args string array, add one to it for NULL at the end*/
-	args_t *program = (args_t *)malloc(sizeof(args_t));
-	if(program != NULL){
-		char **tmp = (char **)malloc(count*sizeof(char *));
-		if(tmp != NULL){
-			int i = 0;
-			int counter = 0;
-			for(i=0; i<len; i++){
-				char word[32];
-				i = p1getword(line, i, word);
-				char *str = p1strdup(word);
-				if(str != NULL){
-					tmp[counter] = str;
-					counter++;
-				}
-				else{
-					/*clean up everything that was allocated*/
-					clean_up(program);
-					return NULL;
-				}
+int load_image(int fd, args_t **head, int *num_progs, int *deps){
+	wl_header_t *h;
+	args_t *current = NULL;
+	char **argv;
+	uint64_t total = 0;
+	uint32_t i, j;
+	if(!wl_map(fd, &image))
+		return 0;
+	h = image.header;
+	/*jobs may share argv ranges, so the copies are counted rather than the table*/
+	for(i=0; i<h->njobs; i++){
+		wl_job_t *w = &image.jobs[i];
+		if(w->argc == 0 || (uint64_t)w->argv + w->argc > h->nargv
+		   || (w->gang != WL_NONE && w->gang >= h->pool_size)
+		   || (w->name != WL_NONE && w->name >= h->pool_size)
+		   || (w->after != WL_NONE && w->after >= h->pool_size)
+		   || (total += (uint64_t)w->argc + 1) > (uint64_t)h->nargv + h->njobs){
+			p1putstr(2, "workload image: job table out of bounds\n");
+			return 0;
+		}
+	}
+	image_args = (args_t *)malloc((h->njobs + 1)*sizeof(args_t));
+	image_argv = (char **)malloc((total + 1)*sizeof(char *));/*room for each NULL*/
+	if(image_args == NULL || image_argv == NULL){
+		p1perror(2, "Failed to allocate workload");
+		return 0;
+	}
+	argv = image_argv;
+	for(i=0; i<h->njobs; i++){
+		wl_job_t *w = &image.jobs[i];
+		args_t *program = &image_args[i];
+		program->args = argv;
+		for(j=0; j<w->argc; j++){
+			if(image.argv[w->argv+j] >= h->pool_size){
+				p1putstr(2, "workload image: argv table out of bounds\n");
+				return 0;
 			}
-			tmp[counter]=NULL;
-			program->args = tmp;
-			program->next = NULL;
-		}	
-		else{
-			free(program);
-			return NULL;
+			*argv++ = image.pool + image.argv[w->argv+j];
+		}
+		*argv++ = NULL;
+		program->next = NULL;
+		program->gang = (w->gang == WL_NONE) ? NULL : image.pool + w->gang;
+		program->name = (w->name == WL_NONE) ? NULL : image.pool + w->name;
+		program->after = (w->after == WL_NONE) ? NULL : image.pool + w->after;
+		program->first = w->first;
+		program->last = w->last;
+		program->cpu_budget = w->cpu_budget;
+		program->wall_budget = w->wall_budget;
+		if((program->exe = ln_resolve(program->args[0])) == -1){
+			p1perror(2, program->args[0]);
+			continue;
 		}
+		if(program->first <= program->last && (program->name != NULL || program->after != NULL)){
+			p1putstr(2, "workload: a job array cannot have name= or after=\n");
+			continue;
+		}
+		(*num_progs)++;
+		*deps |= (program->name != NULL || program->after != NULL);
+		if(*head == NULL)
+			*head = program;
+		else
+			current->next = program;
+		current = program;
 	}
-	return program;
+	return 1;
+}
+
+/*
+releases the workload list of a compiled image and unmaps it
+*/
+void free_image(){
+	free(image_args);
+	free(image_argv);
+	image_args = NULL;
+	image_argv = NULL;
+	if(image.base != NULL)
+		wl_unmap(&image);
 }
 
 /*
-processes file or stdin
+processes file or stdin, which may hold a compiled image (see usps-compile)
 return NULL if unsuccessful
 */
 void process_fd(int fd){
-	int file = 1;
+	int file = (fd >= 0);/*a daemon may start without a workload*/
 	int num_progs = 0;
+	int deps = 0;/*some line has a name or runs after another*/
+	int loaded = 1;
+	int i;
 	args_t *head = NULL;
 	args_t *current = NULL;
 
+	if(file && wl_is_image(fd)){
+		file = 0;
+		loaded = load_image(fd, &head, &num_progs, &deps);
+	}
 	while(file){
-		char nextLine[LINE_SIZE];/*workload file or stdins lines get saved here*/
+		char nextLine[WL_LINE_MAX];/*workload file or stdins lines get saved here*/
 		args_t *program;
-		file = p1getline(fd, nextLine, LINE_SIZE);
+		file = p1getline(fd, nextLine, WL_LINE_MAX);
 		if(file){
 			program = process_cmd(nextLine);
+			if(program != NULL && program->exe == -1){
+				/*reported now rather than by a child after the fork*/
+				p1perror(2, program->args[0]);
+				clean_up(program);
+				program = NULL;
+			}
+			else if(program != NULL && program->first <= program->last
+			        && (program->name != NULL || program->after != NULL)){
+				p1putstr(2, "workload: a job array cannot have name= or after=\n");
+				clean_up(program);
+				program = NULL;
+			}
 			if(program != NULL){
 				num_progs++;
+				deps |= (program->name != NULL || program->after != NULL);
 				if(head == NULL)
 					head = current = program;
 				else
@@ -340,114 +2234,232 @@ void process_fd(int fd){
 			}
 		}
 	}
-	execute_cmds(head, num_progs);
-	clean_up(head);/*after clean up, parent process and failed child processes exit*/
-	if(ready_q != NULL){
-		bq_destroy(ready_q, NULL);
+	if(!loaded || (deps && !build_dag(head)))
+		;/*reported by load_image() or build_dag()*/
+	else if(ctl_fd() != -1)
+		run_daemon(head);
+	else
+		execute_cmds(head, num_progs);
+	if(image_args != NULL || image.base != NULL)
+		free_image();
+	else
+		clean_up(head);/*after clean up, parent process and failed child processes exit*/
+	clean_up(submitted);
+	if(placing)
+		report_placement();
+	if(subreaper)
+		report_orphans();
+	report_budgets();
+	report_quality();
+	HP_REPORT(2);
+	report_gangs();
+	if(dag != NULL){
+		long skipped = 0;
+		for(i=0; i<num_jobs; i++)
+			skipped += jobs[i]->skipped;
+		if(skipped > 0){
+			p1bputstr(2, "dag: ");
+			p1bputlong(2, skipped);
+			p1bputstr(2, " jobs skipped, as a job they run after failed\n");
+			p1bflush(2);
+		}
+		dag_destroy(dag);
+		dag = NULL;
+	}
+	free(dag_stack);
+	free_gangs();
+	free_jobs();
+	for(i=0; i<num_nodes; i++){
+		if(ready_q[i] != NULL)
+			pol_destroy(ready_q[i]);
 	}
+	free(slots);
 }
 
 
 int main(int argc, char *argv[]){
-	if(argc > 3){
-		p1perror(2, USAGE);
-		return 0;
-	}
-
-	if(argc==1){
-
-		/*quantum value not specified, get it from the environment*/
-		char *c = getenv("USPS_QUANTUM_MSEC");
-
-		if(c == NULL){
-			p1putstr(2, USAGE);
-			p1perror(2, "environment variable 'USPS_QUANTUM_MSEC' not detected nor specified\n");
-			return 0;
-		}
-		quantum = p1atoi(c);/*got it from the environment*/
-
-		/*process stdin*/
-		process_fd(0);
-
-	}
-	else if(argc==2){
-
-		/*check if the first argument specifies the quantum value*/
-		if(p1strneq(argv[1], "--quantum=", 10)){
+	char *workload = NULL;/*workload file, or trace file when simulating*/
+	int simulate = 0;/*set by --simulate: replay a trace instead of forking*/
+	char *trace = NULL;/*set by --trace=<file>: record scheduling events*/
+	char *metrics = NULL;/*set by --metrics=<socket>: serve live metrics*/
+	char *daemon = NULL;/*set by --daemon=<socket>: accept jobs at runtime*/
+	char *psi_spec = NULL;/*set by --psi=<triggers>: pressure governor*/
+	int cpus = 0;/*set by --cpus=<n>: slots to place jobs on, 0 for one unpinned*/
+	int fd = 0;
+	int i;
 
-			char c[10];
-			p1strcpy(c, argv[1]+10);
+	/*the environment provides the default quantum, the command line overrides it*/
+	char *c = getenv("USPS_QUANTUM_MSEC");
+	if(c != NULL)
+		quantum = p1atoi(c);
 
-			if(c[0]=='-'){
+	for(i=1; i<argc; i++){
+		if(p1strneq(argv[i], "--quantum=", 10)){
+			if(argv[i][10]=='-'){
 				p1perror(2, "Negative number is not accepted\n");
 				return 0;
 			}
-			quantum = p1atoi(c);/*if the quantum argument is specified, we set it*/
-
-			/*process stdin*/
-			process_fd(0);
+			quantum = p1atoi(argv[i]+10);
 		}
-		/*first argument is not the quantum value, check the environment*/
-		else{
-
-			/*quantum value not specified, get it from the environment*/
-			char *c = getenv("USPS_QUANTUM_MSEC");
-
-			if(c == NULL){
+		else if(p1strneq(argv[i], "--simulate", 11)){
+			simulate = 1;
+		}
+		else if(p1strneq(argv[i], "--trace=", 8)){
+			trace = argv[i]+8;
+		}
+		else if(p1strneq(argv[i], "--metrics=", 10)){
+			metrics = argv[i]+10;
+		}
+		else if(p1strneq(argv[i], "--daemon=", 9)){
+			daemon = argv[i]+9;
+		}
+		else if(p1strneq(argv[i], "--psi=", 6)){
+			psi_spec = argv[i]+6;
+		}
+		else if(p1strneq(argv[i], "--max-live=", 11)){
+			if(argv[i][11] < '0' || argv[i][11] > '9'){
 				p1putstr(2, USAGE);
-				p1perror(2, "environment variable 'USPS_QUANTUM_MSEC' not detected nor specified\n");
 				return 0;
 			}
-			quantum = p1atoi(c);/*got it from the environment*/
-			/*if quantum is out of bounds*/
-			if(quantum < 20 || quantum > 1000){
-				p1perror(2, "The minimum quantum is 20 ms, the maximum quantum is 1000 ms\n");
+			max_live = p1atoi(argv[i]+11);
+		}
+		else if(p1strneq(argv[i], "--gang", 7)){
+			gang_mode = 1;
+		}
+		else if(p1strneq(argv[i], "--subreaper", 12)){
+			subreaper = 1;
+		}
+		else if(p1strneq(argv[i], "--tickless", 11)){
+			tickless = 1;
+		}
+		else if(p1strneq(argv[i], "--cpu-budget=", 13) || p1strneq(argv[i], "--wall-budget=", 14)
+		        || p1strneq(argv[i], "--grace=", 8)){
+			int at = p1strchr(argv[i], '=') + 1;
+			if(argv[i][at] < '0' || argv[i][at] > '9'){
+				p1putstr(2, USAGE);
 				return 0;
 			}
-			/*process the argument*/
-			int fd;
-			fd = open(argv[1], O_RDONLY);
-
-			if(fd == -1){
-				p1perror(2, "Error occured while openning file\n");
+			if(argv[i][2] == 'c')
+				default_cpu_budget = p1atoi(argv[i]+at);
+			else if(argv[i][2] == 'w')
+				default_wall_budget = p1atoi(argv[i]+at);
+			else
+				grace_ms = p1atoi(argv[i]+at);
+		}
+		else if(p1strneq(argv[i], "--cpus=", 7)){
+			if(argv[i][7] < '1' || argv[i][7] > '9'){
+				p1putstr(2, USAGE);
 				return 0;
 			}
-			process_fd(fd);
-			close(fd);
+			cpus = p1atoi(argv[i]+7);
 		}
-	}
-	else{
-
-		/*both quantum and workload file specified*/
-		if(!p1strneq(argv[1], "--quantum=", 10)){
+		else if(p1strneq(argv[i], "--launch=", 9)){
+			if((launch_engine = ln_engine(argv[i]+9)) == -1){
+				p1putstr(2, USAGE);
+				return 0;
+			}
+		}
+		else if(argv[i][0]=='-' && argv[i][1]=='-'){
 			p1putstr(2, USAGE);
 			return 0;
 		}
-		char c[10];
-		p1strcpy(c, argv[1]+10);
-
-		if(c[0]=='-'){
-			p1perror(2, "Negative number is not accepted\n");
+		else if(workload == NULL){
+			workload = argv[i];
+		}
+		else{
+			p1putstr(2, USAGE);
 			return 0;
 		}
-		quantum = p1atoi(c);
-		/*if quantum is out of bounds*/
-		if(quantum < 20 || quantum > 1000){
-			p1perror(2, "The minimum quantum is 20 ms, the maximum quantum is 1000 ms\n");
+	}
+
+	if(quantum == -1){
+		p1putstr(2, USAGE);
+		p1perror(2, "environment variable 'USPS_QUANTUM_MSEC' not detected nor specified\n");
+		return 0;
+	}
+	/*if quantum is out of bounds*/
+	if(quantum < 20 || quantum > 1000){
+		p1perror(2, "The minimum quantum is 20 ms, the maximum quantum is 1000 ms\n");
+		return 0;
+	}
+
+	if(daemon != NULL && simulate){
+		p1putstr(2, USAGE);
+		return 0;
+	}
+	if(daemon != NULL && workload == NULL)
+		fd = -1;/*a daemon does not read its workload from stdin*/
+
+	/*the launcher is forked while the scheduler is small and has nothing open*/
+	if(launch_engine == LN_ZYGOTE && !simulate && !ln_server_start())
+		return 0;
+
+	if(subreaper && !simulate){
+		if(prctl(PR_SET_CHILD_SUBREAPER, 1L, 0L, 0L, 0L) == -1){
+			p1perror(2, "--subreaper");
 			return 0;
 		}
-		/*process the 2nd argument*/
-		int fd;
-		fd = open(argv[2], O_RDONLY);
+		ln_defaults(&own_group);
+		own_group.pgroup = 1;
+	}
 
+	if(workload != NULL){
+		fd = open(workload, O_RDONLY);
 		if(fd == -1){
 			p1perror(2, "Error occured while openning file\n");
 			return 0;
 		}
-		process_fd(fd);
-		close(fd);
 	}
 
+	if(trace != NULL && !tr_open(trace, 0L)){
+		if(fd > 0)
+			close(fd);
+		return 0;
+	}
+
+	if((metrics != NULL && !simulate && !mx_open(metrics))
+	   || (daemon != NULL && !ctl_open(daemon))
+	   || (psi_spec != NULL && !simulate && !(psi_on = psi_open(psi_spec)))
+	   || (!simulate && !set_up_slots(cpus))){
+		tr_close();
+		mx_close();
+		ctl_close();
+		if(fd > 0)
+			close(fd);
+		return 0;
+	}
+
+	if(simulate){
+		if(!sim_run(fd, quantum)){
+			tr_close();
+			if(fd != 0)
+				close(fd);
+			return 0;
+		}
+	}
+	else
+		process_fd(fd);
+
+	if(getpid() == ppid || simulate){
+		tr_close();/*a child whose exec failed must not write the parent's trace*/
+		mx_close();
+		ctl_close();
+	}
+	if(psi_on){
+		long episodes;
+		uint64_t ns = psi_throttled_ns(tr_now(), &episodes);
+		p1bputstr(2, "psi: throttled for ");
+		p1bputlong(2, (long)(ns / 1000000ULL));
+		p1bputstr(2, " ms in ");
+		p1bputlong(2, episodes);
+		p1bputstr(2, " episodes\n");
+		p1bflush(2);
+		psi_close();
+	}
+	ln_server_stop();
+	ln_resolve_clear();
+	if(fd > 0)
+		close(fd);
 	return 1;
 
-}
\ No newline at end of file
+}
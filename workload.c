@@ -0,0 +1,362 @@
+/*
+ * implementation for workload files
+ */
+
+#include "workload.h"
+#include "p1fxns.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/*
+ * counts the words of `line'; text in quotation marks counts as one word
+ */
+static int word_count(char *line) {
+    int i = 0, count = 0, word_char = 0;
+    int len = p1strlen(line);
+
+    while (line[i] == ' ' || line[i] == '\t' || line[i] == '\n' || line[i] == '\'' || line[i] == '\"')
+        i++;
+    if (i >= len)
+        return count;
+    while (line[i] != '\0') {
+        if (line[i] != ' ' && line[i] != '\t' && line[i] != '\n' && line[i] != '\'' && line[i] != '\"') {
+            count++;
+            word_char = 1;	/* now we're in a word */
+        }
+        while (word_char) {
+            i++;
+            if (line[i] == '\0' || line[i] == ' ' || line[i] == '\t' || line[i] == '\n'
+                || line[i] == '\'' || line[i] == '\"')
+                word_char = 0;
+        }
+        if (line[i] != '\0')
+            i++;
+    }
+    return count;
+}
+
+/*
+ * parses a job array's range, "[<first>-<last>]" with first <= last
+ *
+ * returns 1 if `word' is one, 0 if not (e.g. the command [)
+ */
+static int parse_range(char *word, long *first, long *last) {
+    int i = 1, j;
+
+    if (word[0] != '[' || word[1] < '0' || word[1] > '9')
+        return 0;
+    while (word[i] >= '0' && word[i] <= '9')
+        i++;
+    if (word[i] != '-' || word[i + 1] < '0' || word[i + 1] > '9')
+        return 0;
+    j = ++i;
+    while (word[j] >= '0' && word[j] <= '9')
+        j++;
+    if (word[j] != ']' || word[j + 1] != '\0' || p1atoi(word + 1) > p1atoi(word + i))
+        return 0;
+    *first = p1atoi(word + 1);
+    *last = p1atoi(word + i);
+    return 1;
+}
+
+int wl_parse(char *line, wl_line_t *l) {
+    int len = p1strlen(line);
+    int count, counter = 0, i = 0;
+
+    if (len > 0 && line[len - 1] == '\n')
+        line[--len] = '\0';
+    l->gang = l->name = l->after = NULL;
+    l->first = 0;
+    l->last = -1;
+    l->cpu_budget = l->wall_budget = 0;
+    if ((count = word_count(line)) == 0)
+        return 0;
+    if ((l->args = (char **)malloc((count + 1) * sizeof(char *))) == NULL)
+        return -1;
+    l->args[0] = NULL;
+    {
+        char word[len + 1];	/* a word is never longer than the line */
+
+        while (counter < count && (i = p1getword(line, i, word)) != -1) {
+            char **attr = NULL;
+
+            if (counter == 0 && parse_range(word, &l->first, &l->last))
+                continue;
+            if (counter == 0 && p1strneq(word, "cpu_budget=", 11)) {
+                l->cpu_budget = p1atoi(word + 11);
+                continue;
+            }
+            if (counter == 0 && p1strneq(word, "wall_budget=", 12)) {
+                l->wall_budget = p1atoi(word + 12);
+                continue;
+            }
+            if (counter == 0) {
+                if (p1strneq(word, "gang=", 5))
+                    attr = &l->gang;
+                else if (p1strneq(word, "name=", 5))
+                    attr = &l->name;
+                else if (p1strneq(word, "after=", 6))
+                    attr = &l->after;
+            }
+            if (attr != NULL) {
+                free(*attr);
+                if ((*attr = p1strdup(word + p1strchr(word, '=') + 1)) == NULL) {
+                    wl_free(l);
+                    return -1;
+                }
+                continue;
+            }
+            if ((l->args[counter] = p1strdup(word)) == NULL) {
+                wl_free(l);
+                return -1;
+            }
+            l->args[++counter] = NULL;
+        }
+    }
+    if (counter == 0) {		/* attributes but no command */
+        wl_free(l);
+        return 0;
+    }
+    return 1;
+}
+
+void wl_free(wl_line_t *l) {
+    int i;
+
+    for (i = 0; l->args[i] != NULL; i++)
+        free(l->args[i]);
+    free(l->args);
+    free(l->gang);
+    free(l->name);
+    free(l->after);
+    l->args = NULL;
+    l->gang = l->name = l->after = NULL;
+}
+
+int wl_is_image(int fd) {
+    char magic[8];
+
+    return pread(fd, magic, 8, 0) == 8 && memcmp(magic, WL_MAGIC, 8) == 0;
+}
+
+static int bad_image(char *why) {
+    p1putstr(2, "workload image: ");
+    p1putstr(2, why);
+    p1putstr(2, "\n");
+    return 0;
+}
+
+int wl_map(int fd, wl_image_t *img) {
+    struct stat st;
+    wl_header_t *h;
+    uint64_t size;
+
+    if (fstat(fd, &st) == -1 || st.st_size < (long)sizeof(wl_header_t))
+        return bad_image("too short");
+    img->size = st.st_size;
+    size = (uint64_t)img->size;
+    img->base = (char *)mmap(NULL, img->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (img->base == MAP_FAILED) {
+        img->base = NULL;
+        p1perror(2, "workload image");
+        return 0;
+    }
+    h = img->header = (wl_header_t *)img->base;
+    if (memcmp(h->magic, WL_MAGIC, 8) != 0 || h->version != WL_VERSION) {
+        wl_unmap(img);
+        return bad_image("wrong magic or version, recompile it with usps-compile");
+    }
+    /* each offset is checked before a length is added to it, so no sum can wrap */
+    if (h->jobs_off % 8 != 0 || h->argv_off % 4 != 0
+        || h->jobs_off > size || h->njobs > (size - h->jobs_off) / sizeof(wl_job_t)
+        || h->argv_off > size || h->nargv > (size - h->argv_off) / sizeof(uint32_t)
+        || h->pool_off > size || h->pool_size > size - h->pool_off
+        || h->pool_size == 0 || img->base[h->pool_off + h->pool_size - 1] != '\0') {
+        wl_unmap(img);
+        return bad_image("tables out of bounds");
+    }
+    img->jobs = (wl_job_t *)(img->base + h->jobs_off);
+    img->argv = (uint32_t *)(img->base + h->argv_off);
+    img->pool = img->base + h->pool_off;
+    return 1;
+}
+
+void wl_unmap(wl_image_t *img) {
+    munmap(img->base, img->size);
+    img->base = NULL;
+}
+
+struct wl_writer {
+    wl_job_t *jobs;
+    long njobs, jobs_cap;
+    uint32_t *argv;
+    long nargv, argv_cap;
+    char *pool;
+    long pool_size, pool_cap;
+    uint32_t *table;	/* pool offsets of the strings, hashed; WL_NONE if free */
+    long table_size, nstrings;
+};
+
+/*
+ * makes room for `more' items of `size' bytes after `n' in `*array'
+ */
+static int grow(void **array, long *cap, long n, long more, long size) {
+    long c = (*cap == 0) ? 64 : *cap;
+    void *tmp;
+
+    if (n + more <= *cap)
+        return 1;
+    while (c < n + more)
+        c *= 2;
+    if ((tmp = realloc(*array, c * size)) == NULL)
+        return 0;
+    *array = tmp;
+    *cap = c;
+    return 1;
+}
+
+static unsigned long hash(char *s) {
+    unsigned long h = 14695981039346656037UL;	/* FNV-1a */
+
+    for (; *s != '\0'; s++)
+        h = (h ^ (unsigned char)*s) * 1099511628211UL;
+    return h;
+}
+
+/*
+ * returns the pool offset of `s', adding it if it is new, or WL_NONE if
+ * there are malloc() errors or the pool is full
+ */
+static uint32_t intern(WlWriter *w, char *s) {
+    long len = p1strlen(s) + 1, i;
+    uint32_t off;
+
+    if (2 * (w->nstrings + 1) > w->table_size) {	/* rehash at half full */
+        long size = 2 * w->table_size;
+        uint32_t *table = (uint32_t *)malloc(size * sizeof(uint32_t));
+
+        if (table == NULL)
+            return WL_NONE;
+        memset(table, 0xff, size * sizeof(uint32_t));
+        for (i = 0; i < w->table_size; i++) {
+            unsigned long h;
+
+            if (w->table[i] == WL_NONE)
+                continue;
+            for (h = hash(w->pool + w->table[i]) & (size - 1); table[h] != WL_NONE; h = (h + 1) & (size - 1))
+                ;
+            table[h] = w->table[i];
+        }
+        free(w->table);
+        w->table = table;
+        w->table_size = size;
+    }
+    for (i = hash(s) & (w->table_size - 1); w->table[i] != WL_NONE; i = (i + 1) & (w->table_size - 1))
+        if (p1strneq(w->pool + w->table[i], s, len))
+            return w->table[i];
+    if (w->pool_size + len >= (long)WL_NONE || !grow((void **)&w->pool, &w->pool_cap, w->pool_size, len, 1))
+        return WL_NONE;
+    off = (uint32_t)w->pool_size;
+    memcpy(w->pool + off, s, len);
+    w->pool_size += len;
+    w->table[i] = off;
+    w->nstrings++;
+    return off;
+}
+
+WlWriter *wl_writer_create(void) {
+    WlWriter *w = (WlWriter *)calloc(1, sizeof(WlWriter));
+
+    if (w != NULL) {
+        w->table_size = 1024;
+        if ((w->table = (uint32_t *)malloc(w->table_size * sizeof(uint32_t))) == NULL) {
+            free(w);
+            return NULL;
+        }
+        memset(w->table, 0xff, w->table_size * sizeof(uint32_t));
+    }
+    return w;
+}
+
+int wl_writer_add(WlWriter *w, wl_line_t *l) {
+    wl_job_t *job;
+    long argc;
+
+    for (argc = 0; l->args[argc] != NULL; argc++)
+        ;
+    if (w->njobs == (long)WL_NONE || w->nargv + argc >= (long)WL_NONE
+        || !grow((void **)&w->jobs, &w->jobs_cap, w->njobs, 1, sizeof(wl_job_t))
+        || !grow((void **)&w->argv, &w->argv_cap, w->nargv, argc, sizeof(uint32_t)))
+        return 0;
+    job = &w->jobs[w->njobs];
+    job->first = l->first;
+    job->last = l->last;
+    job->argv = (uint32_t)w->nargv;
+    job->argc = (uint32_t)argc;
+    job->gang = job->name = job->after = job->unused = WL_NONE;
+    job->cpu_budget = (uint32_t)l->cpu_budget;
+    job->wall_budget = (uint32_t)l->wall_budget;
+    if ((l->gang != NULL && (job->gang = intern(w, l->gang)) == WL_NONE)
+        || (l->name != NULL && (job->name = intern(w, l->name)) == WL_NONE)
+        || (l->after != NULL && (job->after = intern(w, l->after)) == WL_NONE))
+        return 0;
+    for (argc = 0; l->args[argc] != NULL; argc++)
+        if ((w->argv[w->nargv + argc] = intern(w, l->args[argc])) == WL_NONE)
+            return 0;
+    w->nargv += argc;
+    w->njobs++;
+    return 1;
+}
+
+static int write_all(int fd, void *buf, long n) {
+    char *p = (char *)buf;
+
+    while (n > 0) {
+        long k = write(fd, p, n);
+
+        if (k == -1 && errno == EINTR)
+            continue;
+        if (k <= 0)
+            return 0;
+        p += k;
+        n -= k;
+    }
+    return 1;
+}
+
+int wl_writer_write(WlWriter *w, int fd) {
+    wl_header_t h;
+    char pad[8] = {0};
+    long jobs_off = (sizeof(wl_header_t) + 7) & ~7L;
+
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, WL_MAGIC, 8);
+    h.version = WL_VERSION;
+    h.njobs = (uint32_t)w->njobs;
+    h.nargv = w->nargv;
+    h.pool_size = w->pool_size;
+    h.jobs_off = jobs_off;
+    h.argv_off = jobs_off + w->njobs * sizeof(wl_job_t);
+    h.pool_off = h.argv_off + w->nargv * sizeof(uint32_t);
+    if (!write_all(fd, &h, sizeof(h))
+        || !write_all(fd, pad, jobs_off - sizeof(h))
+        || !write_all(fd, w->jobs, w->njobs * sizeof(wl_job_t))
+        || !write_all(fd, w->argv, w->nargv * sizeof(uint32_t))
+        || !write_all(fd, w->pool, w->pool_size)) {
+        p1perror(2, "workload image");
+        return 0;
+    }
+    return 1;
+}
+
+void wl_writer_destroy(WlWriter *w) {
+    free(w->jobs);
+    free(w->argv);
+    free(w->pool);
+    free(w->table);
+    free(w);
+}
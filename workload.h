@@ -0,0 +1,138 @@
+#ifndef _WORKLOAD_H_
+#define _WORKLOAD_H_
+
+/*
+ * interface definition for workload files
+ *
+ * a workload line is [<attribute>...] command [args...], where the
+ * attributes are [<first>-<last>] (a job array), gang=<name>, name=<name>,
+ * after=<name>[,<name>...], cpu_budget=<msec> and wall_budget=<msec>;
+ * quoted arguments count as one word
+ *
+ * usps-compile turns a workload file into a compiled image, which the
+ * scheduler maps and launches from without parsing anything:
+ *
+ *	header		wl_header_t, at offset 0
+ *	job table	njobs wl_job_t, at jobs_off
+ *	argv table	nargv uint32_t offsets into the pool, at argv_off
+ *	string pool	pool_size bytes of NUL-terminated strings, at pool_off
+ *
+ * every string is stored once in the pool, however many jobs use it; all
+ * integers are in the byte order of the machine that compiled the image
+ */
+
+#include <stdint.h>
+
+#define WL_LINE_MAX 128			/* longest workload line, newline included */
+#define WL_MAGIC "USPSWL\r\n"		/* 8 bytes, no NUL */
+#define WL_VERSION 2
+#define WL_NONE 0xffffffffU		/* pool offset of an absent attribute */
+
+typedef struct wl_line {
+    char **args;	/* NULL-terminated */
+    char *gang;		/* NULL if absent, as are name and after */
+    char *name;
+    char *after;
+    long first;		/* job array range; first > last if not an array */
+    long last;
+    long cpu_budget;	/* msec, 0 if none, as is wall_budget */
+    long wall_budget;
+} wl_line_t;
+
+typedef struct wl_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t njobs;
+    uint64_t nargv;
+    uint64_t pool_size;
+    uint64_t jobs_off;
+    uint64_t argv_off;
+    uint64_t pool_off;
+} wl_header_t;
+
+typedef struct wl_job {
+    int64_t first;	/* job array range; first > last if not an array */
+    int64_t last;
+    uint32_t argv;	/* index of the job's argv[0] in the argv table */
+    uint32_t argc;
+    uint32_t gang;	/* pool offsets, WL_NONE if absent */
+    uint32_t name;
+    uint32_t after;
+    uint32_t cpu_budget;	/* msec, 0 if none, as is wall_budget */
+    uint32_t wall_budget;
+    uint32_t unused;
+} wl_job_t;
+
+typedef struct wl_image {
+    char *base;		/* the mapping */
+    long size;
+    wl_header_t *header;
+    wl_job_t *jobs;
+    uint32_t *argv;
+    char *pool;
+} wl_image_t;
+
+typedef struct wl_writer WlWriter;	/* opaque type definition */
+
+/*
+ * splits `line' (a trailing newline is dropped) into `l'
+ *
+ * returns 1 if successful, 0 if the line has no command, -1 if there are
+ * malloc() errors
+ */
+int wl_parse(char *line, wl_line_t *l);
+
+/*
+ * frees what wl_parse() allocated in `l'
+ */
+void wl_free(wl_line_t *l);
+
+/*
+ * returns 1 if the file open on `fd' is a compiled image, 0 if not (e.g.
+ * text, or a pipe); the file offset does not change
+ */
+int wl_is_image(int fd);
+
+/*
+ * maps the compiled image open on `fd' read-only into `img', checking that
+ * its header and tables are consistent
+ *
+ * returns 1 if successful, 0 if not (the reason has been written to
+ * standard error)
+ */
+int wl_map(int fd, wl_image_t *img);
+
+/*
+ * unmaps an image mapped by wl_map()
+ */
+void wl_unmap(wl_image_t *img);
+
+/*
+ * creates a writer for a compiled image
+ *
+ * returns a pointer to the writer, or NULL if there are malloc() errors
+ */
+WlWriter *wl_writer_create(void);
+
+/*
+ * appends the job described by `l' to the image
+ *
+ * returns 1 if successful, 0 if there are malloc() errors or the image
+ * has outgrown its 32-bit offsets
+ */
+int wl_writer_add(WlWriter *w, wl_line_t *l);
+
+/*
+ * writes the image to `fd'
+ *
+ * returns 1 if successful, 0 if not (the reason has been written to
+ * standard error)
+ */
+int wl_writer_write(WlWriter *w, int fd);
+
+/*
+ * destroys the writer
+ */
+void wl_writer_destroy(WlWriter *w);
+
+#endif /* _WORKLOAD_H_ */